@@ -0,0 +1,62 @@
+/**
+ * The ArUco action server as a nodelet. Loaded into a camera's manager, it
+ * keeps that camera's recent frames (see tfr_sensor/image_wrapper.h) and
+ * detects in them as shared pointers, so a goal without an image costs no
+ * copy or serialization of the frame at all. Goals that carry an image are
+ * still served as by the standalone node.
+ *
+ * Parameters:
+ * ~camera_topic: the camera topic to subscribe to (string, default: "")
+ * ~service_name: also serves the frames as tfr_msgs/WrappedImage for out
+ * of process users, not advertised if empty (string, default: "")
+ * ~buffer_size: how many recent frames to keep (int, default: 30)
+ * ~action_name: (string, default: "aruco_action_server")
+ * ~workers: goals detected at once (int, default: 2)
+ * ~odom_frame, ~roi_padding, ~track_timeout, ~pyramid_levels: the
+ * detector's, see aruco_server.h
+ * */
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+#include <memory>
+#include "aruco_server.h"
+
+namespace tfr_aruco
+{
+    class ArucoNodelet : public nodelet::Nodelet
+    {
+        public:
+            ArucoNodelet() = default;
+            ~ArucoNodelet() = default;
+            ArucoNodelet(const ArucoNodelet&) = delete;
+            ArucoNodelet& operator=(const ArucoNodelet&) = delete;
+            ArucoNodelet(ArucoNodelet&&) = delete;
+            ArucoNodelet& operator=(ArucoNodelet&&) = delete;
+
+        private:
+            void onInit() override
+            {
+                ros::NodeHandle &p = getPrivateNodeHandle();
+                std::string camera_topic{}, service_name{}, action_name{};
+                int buffer_size, workers;
+                p.param<std::string>("camera_topic", camera_topic, "");
+                p.param<std::string>("service_name", service_name, "");
+                p.param<int>("buffer_size", buffer_size, 30);
+                p.param<std::string>("action_name", action_name, "aruco_action_server");
+                p.param<int>("workers", workers, 2);
+                workers = std::max(workers, 1);
+
+                aruco.reset(new TFR_Aruco{p});
+                camera.reset(new ImageWrapper{getNodeHandle(), camera_topic,
+                        service_name, buffer_size});
+                server.reset(new ArucoServer{getNodeHandle(), action_name,
+                        *aruco, workers, camera.get()});
+            }
+
+            //declared last so it is torn down first, its workers use the other two
+            std::unique_ptr<TFR_Aruco> aruco;
+            std::unique_ptr<ImageWrapper> camera;
+            std::unique_ptr<ArucoServer> server;
+    };
+}
+
+PLUGINLIB_EXPORT_CLASS(tfr_aruco::ArucoNodelet, nodelet::Nodelet)
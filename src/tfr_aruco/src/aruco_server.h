@@ -0,0 +1,591 @@
+/*
+ * The ArUco board detector and the action server that runs it on a pool of
+ * workers. Used by the standalone aruco_action_server node, which detects in
+ * the images its goals carry, and by tfr_aruco/ArucoNodelet, which runs in a
+ * camera's nodelet manager and detects in that camera's frames without them
+ * ever being copied or serialized.
+ *
+ * detector parameters, from the node handle given to TFR_Aruco:
+ *   odom_frame: the camera's motion between images is taken in this frame
+ *   (string, default: "odom")
+ *   roi_padding: grows the predicted board outline by this fraction of its
+ *   size (double, default: 0.25)
+ *   track_timeout: older sightings aren't predicted from [s] (double,
+ *   default: 1.0)
+ *   pyramid_levels: how many times the image is halved for the first
+ *   search (int, default: 1)
+ * */
+#ifndef ARUCO_SERVER_H
+#define ARUCO_SERVER_H
+
+#include "ros/ros.h"
+
+// aruco and ROS-openCV bindings
+#include <opencv2/aruco.hpp>
+#include <image_transport/image_transport.h>
+#include <cv_bridge/cv_bridge.h>
+#include <opencv2/imgproc.hpp>
+#include <sensor_msgs/image_encodings.h>
+#include <tfr_msgs/ArucoAction.h>
+#include <actionlib/server/action_server.h>
+#include <opencv2/core/utility.hpp>
+#include <tf2/LinearMath/Quaternion.h>
+#include <tf2/LinearMath/Matrix3x3.h>
+#include <tf2_ros/buffer.h>
+#include <tf2_ros/transform_listener.h>
+#include <tfr_sensor/image_wrapper.h>
+#include "generatedMarker.h"
+//Hello
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+typedef actionlib::ActionServer<tfr_msgs::ArucoAction> Server;
+typedef Server::GoalHandle GoalHandle;
+
+/*
+ * Everything a detection writes to, one per worker so workers never
+ * share it. The buffers are reused from goal to goal, so a frame doesn't
+ * allocate once the first few have been seen at full size.
+ * */
+struct Workspace
+{
+    cv::Ptr<cv::aruco::DetectorParameters> params;
+    cv::Ptr<cv::aruco::DetectorParameters> coarseParams;
+    cv::Mat gray;
+    std::vector<int> ids;
+    std::vector<std::vector<cv::Point2f> > corners;
+    std::vector<cv::Point2f> projected;
+    //halved copies of the gray image, 0 is unused
+    std::vector<cv::Mat> pyramid;
+};
+
+/*
+ * The detector, shared by every worker. Only the intrinsics cache and the
+ * tracks change after construction, and they are locked.
+ * */
+class TFR_Aruco {
+    public:
+        cv::Ptr<cv::aruco::Dictionary> dictionary;
+        cv::Ptr<cv::aruco::Board> board;
+        cv::Ptr<cv::aruco::DetectorParameters> params;
+
+        //parameters are read from the private node handle p
+        explicit TFR_Aruco(const ros::NodeHandle &p) : tfBuffer{}, tfListener{tfBuffer} {
+            dictionary = cv::aruco::getPredefinedDictionary(cv::aruco::DICT_5X5_250);
+
+            // set up board. This method is temporary until an official board is created. Works for now
+            // represents the board that comes in the folder of this project
+            std::vector<std::vector<cv::Point3f> > boardCorners;
+            std::vector<int> boardIds;
+            setBoardData(boardCorners, boardIds);
+
+            board = cv::aruco::Board::create(std::move(boardCorners), dictionary, std::move(boardIds));
+            for (const auto &marker : board->objPoints)
+                boardPoints.insert(boardPoints.end(), marker.begin(), marker.end());
+
+            // tracking the board from frame to frame
+            p.param<std::string>("odom_frame", odomFrame, "odom");
+            p.param<double>("roi_padding", roiPadding, 0.25);
+            p.param<double>("track_timeout", trackTimeout, 1.0);
+
+            // set up params
+            params = cv::Ptr<cv::aruco::DetectorParameters>(new cv::aruco::DetectorParameters);
+            params->cornerRefinementMethod = cv::aruco::CORNER_REFINE_SUBPIX;
+            params->cornerRefinementWinSize = 5;
+
+            // coarse levels only find the markers, corners are refined at full resolution
+            coarseParams = cv::Ptr<cv::aruco::DetectorParameters>(new cv::aruco::DetectorParameters(*params));
+            coarseParams->cornerRefinementMethod = cv::aruco::CORNER_REFINE_NONE;
+            p.param<int>("pyramid_levels", pyramidLevels, 1);
+            pyramidLevels = std::max(pyramidLevels, 0);
+        }
+
+        //a worker's own copy of the detector parameters and buffers
+        Workspace makeWorkspace() const
+        {
+            Workspace workspace{};
+            workspace.params = cv::Ptr<cv::aruco::DetectorParameters>(new cv::aruco::DetectorParameters(*params));
+            workspace.coarseParams = cv::Ptr<cv::aruco::DetectorParameters>(new cv::aruco::DetectorParameters(*coarseParams));
+            return workspace;
+        }
+
+        /* This is the method that will be called when a client makes use
+         * of this server, by one of the workers, with the image of the goal.
+         * The input is the camera model with the camera intrinsics and the image itself.
+         * The image is transformed to a library compatible format followed by detection of
+         * markers in the image by the aruco library. The number of markers found is returned
+         * in the result. Additionally, if any markers were indeed found, the relative pose of
+         * the board is returned as well. False if the image can't be read.
+         **/
+        bool execute(const sensor_msgs::ImageConstPtr& image,
+                const sensor_msgs::CameraInfo& cameraInfo, Workspace& workspace,
+                tfr_msgs::ArucoResult& result)
+        {
+            const std::shared_ptr<const Intrinsics> intrinsics = getIntrinsics(cameraInfo);
+            const cv::Mat &cameraMatrix = intrinsics->cameraMatrix;
+            const cv::Mat &distCoeffs = intrinsics->distCoeffs;
+
+            // detection only needs grayscale, taken straight from the image
+            cv::Mat gray;
+            try 
+            {
+                gray = toGray(image, workspace);
+            }
+            catch (cv_bridge::Exception& e)
+            {
+                ROS_ERROR("cv_bridge exception: %s", e.what());
+                return false;
+            }
+
+            // detect fiducial markers
+            std::vector<int> &markerIds = workspace.ids;
+            std::vector<std::vector<cv::Point2f> > &markerCorners = workspace.corners;
+            markerIds.clear();
+            markerCorners.clear();
+
+            // look where the board should be first, the full frame when that
+            // finds fewer markers than were seen last time
+            int level = 0;
+            cv::Rect roi;
+            std::size_t expected = 0;
+            if (predictRoi(image->header, *intrinsics, gray.size(), workspace, roi, expected))
+            {
+                cv::aruco::detectMarkers(gray(roi), dictionary, markerCorners, markerIds, workspace.params);
+                for (auto &corners : markerCorners)
+                    for (auto &corner : corners)
+                        corner += cv::Point2f(roi.x, roi.y);
+            }
+            if (markerIds.empty() || markerIds.size() < expected)
+                level = detectCoarseToFine(gray, workspace);
+
+            cv::Vec3d boardRotVec, boardTransVec;
+            int markersDetected = cv::aruco::estimatePoseBoard(markerCorners, markerIds, board, cameraMatrix, distCoeffs, boardRotVec, boardTransVec);
+
+            updateTrack(image->header, markersDetected > 0, markerIds.size(),
+                    boardRotVec, boardTransVec);
+
+            result.number_found = markersDetected;
+            result.pyramid_level = level;
+            result.image_stamp = image->header.stamp;
+            if (result.number_found > 0)
+            {
+                //when the image was taken, so it can be transformed as the
+                //robot was then
+                result.relative_pose.header.stamp = image->header.stamp.isZero() ?
+                    ros::Time::now() : image->header.stamp;
+                result.relative_pose.header.frame_id = image->header.frame_id;
+                /*
+                 *  also the coordinate axist for the aruco are in a different
+                 *  coordinate system and are rotated here.
+                 * */
+                result.relative_pose.pose.position.x = boardTransVec[2];
+                result.relative_pose.pose.position.y = boardTransVec[0] * -1; /*y-axis is inverted*/
+                result.relative_pose.pose.position.z = 0;
+                //let tf do the euler angle -> quaternion math
+                tf2::Quaternion rotated{};
+                //change rotated perspective RPY aruco output to ros coordinate system (2d)
+                rotated.setRPY(0,0, -(PI + boardRotVec[1]));
+                result.relative_pose.pose.orientation.x = rotated.x();
+                result.relative_pose.pose.orientation.y = rotated.y();
+                result.relative_pose.pose.orientation.z = rotated.z();
+                result.relative_pose.pose.orientation.w = rotated.w();
+
+                //quality of the estimate, used to weigh it in sensor fusion
+                result.reprojection_error = reprojectionError(markerCorners,
+                        markerIds, cameraMatrix, distCoeffs, boardRotVec, boardTransVec,
+                        workspace.projected);
+                result.viewing_angle = viewingAngle(boardRotVec, boardTransVec);
+            }
+            return true;
+        }
+    private:
+        cv::Ptr<cv::aruco::DetectorParameters> coarseParams;
+        //how many times the image is halved for the first search
+        int pyramidLevels;
+
+        //a camera's intrinsics as opencv wants them, with what they came from
+        struct Intrinsics
+        {
+            sensor_msgs::CameraInfo::_K_type k;
+            sensor_msgs::CameraInfo::_D_type d;
+            cv::Mat cameraMatrix;
+            cv::Mat distCoeffs;
+        };
+        //by camera frame
+        std::map<std::string, std::shared_ptr<const Intrinsics> > intrinsicsCache;
+        std::mutex intrinsicsMutex;
+
+        //where the board was last seen by a camera
+        struct Track
+        {
+            bool valid = false;
+            cv::Vec3d rotVec;
+            cv::Vec3d transVec;
+            ros::Time stamp;
+            std::size_t markers = 0;
+        };
+        //by camera frame
+        std::map<std::string, Track> tracks;
+        std::mutex tracksMutex;
+        //every marker corner on the board
+        std::vector<cv::Point3f> boardPoints;
+
+        tf2_ros::Buffer tfBuffer;
+        tf2_ros::TransformListener tfListener;
+        std::string odomFrame;
+        //grows the predicted board outline by this fraction of its size
+        double roiPadding;
+        //older tracks aren't worth predicting from [s]
+        double trackTimeout;
+        //also added to the board outline, for small boards far away [px]
+        static constexpr int MIN_PADDING = 20;
+        //optical x is link -y, optical y is link -z, optical z is link x
+        const cv::Matx33d LINK_TO_OPTICAL{0, -1, 0,
+            0, 0, -1,
+            1, 0, 0};
+
+        /*
+         * The intrinsics only change if the camera is recalibrated, so they
+         * are rebuilt only when the camera info's contents change. A rebuild
+         * swaps in new intrinsics, workers still using the old ones keep them
+         * alive, so handing them out is only a reference count.
+         * */
+        std::shared_ptr<const Intrinsics> getIntrinsics(const sensor_msgs::CameraInfo &info)
+        {
+            std::lock_guard<std::mutex> lock(intrinsicsMutex);
+            std::shared_ptr<const Intrinsics> &cached = intrinsicsCache[info.header.frame_id];
+            if (cached != nullptr && cached->k == info.K && cached->d == info.D)
+                return cached;
+            auto rebuilt = std::make_shared<Intrinsics>();
+            rebuilt->k = info.K;
+            rebuilt->d = info.D;
+            rebuilt->cameraMatrix = cv::Mat(3, 3, CV_64F);
+            std::copy(info.K.begin(), info.K.end(), rebuilt->cameraMatrix.begin<double>());
+            if (info.D.empty())
+                rebuilt->distCoeffs = cv::Mat::zeros(1, 5, CV_64F);
+            else
+            {
+                rebuilt->distCoeffs = cv::Mat(1, info.D.size(), CV_64F);
+                std::copy(info.D.begin(), info.D.end(), rebuilt->distCoeffs.begin<double>());
+            }
+            cached = rebuilt;
+            return cached;
+        }
+
+        /*
+         * Predicts where the board is in this image from where the camera last
+         * saw it, moved by how much the camera moved in odom since. Without the
+         * motion the old pose is used with twice the padding. False when there
+         * is no recent track, or the window would be most of the image anyway.
+         * Also gives how many markers the track was seen with.
+         * */
+        bool predictRoi(const std_msgs::Header &header, const Intrinsics &intrinsics,
+                const cv::Size &size, Workspace &workspace, cv::Rect &roi,
+                std::size_t &expected)
+        {
+            const std::string &frame = header.frame_id;
+            const ros::Time &stamp = header.stamp;
+            Track track{};
+            {
+                std::lock_guard<std::mutex> lock(tracksMutex);
+                auto found = tracks.find(frame);
+                if (found != tracks.end())
+                    track = found->second;
+            }
+            if (!track.valid || stamp.isZero() || stamp < track.stamp ||
+                    (stamp - track.stamp).toSec() > trackTimeout)
+                return false;
+            expected = track.markers;
+
+            cv::Vec3d rotVec = track.rotVec, transVec = track.transVec;
+            double padding = roiPadding;
+            try
+            {
+                // carries points from the camera then to the camera now, in
+                // the camera's ros frame (x forward, z up)
+                auto motion = tfBuffer.lookupTransform(frame, stamp, frame,
+                        track.stamp, odomFrame, ros::Duration(0.05));
+                const auto &q = motion.transform.rotation;
+                tf2::Matrix3x3 basis{tf2::Quaternion{q.x, q.y, q.z, q.w}};
+                cv::Matx33d linkRotation, boardRotation;
+                for (int i = 0; i < 3; i++)
+                    for (int j = 0; j < 3; j++)
+                        linkRotation(i, j) = basis[i][j];
+                const auto &t = motion.transform.translation;
+                // the track is in opencv's optical axes, the same motion there
+                cv::Matx33d rotation = LINK_TO_OPTICAL * linkRotation * LINK_TO_OPTICAL.t();
+                cv::Vec3d translation = LINK_TO_OPTICAL * cv::Vec3d(t.x, t.y, t.z);
+                cv::Rodrigues(rotVec, boardRotation);
+                cv::Rodrigues(rotation * boardRotation, rotVec);
+                transVec = rotation * transVec + translation;
+            }
+            catch (tf2::TransformException &)
+            {
+                padding *= 2;
+            }
+            if (transVec[2] <= 0)
+                return false;
+
+            std::vector<cv::Point2f> &projected = workspace.projected;
+            cv::projectPoints(boardPoints, rotVec, transVec, intrinsics.cameraMatrix,
+                    intrinsics.distCoeffs, projected);
+            cv::Rect outline = cv::boundingRect(projected);
+            int pad = static_cast<int>(padding * std::max(outline.width, outline.height)) + MIN_PADDING;
+            roi = cv::Rect(outline.x - pad, outline.y - pad,
+                    outline.width + 2 * pad, outline.height + 2 * pad) &
+                cv::Rect(0, 0, size.width, size.height);
+            return roi.area() > 0 && roi.area() < size.area() / 2;
+        }
+
+        /*
+         * Workers can finish images from the same camera out of order, an
+         * older image doesn't replace a newer track.
+         * */
+        void updateTrack(const std_msgs::Header &header, bool found,
+                std::size_t markers, const cv::Vec3d &rotVec, const cv::Vec3d &transVec)
+        {
+            std::lock_guard<std::mutex> lock(tracksMutex);
+            Track &track = tracks[header.frame_id];
+            if (header.stamp < track.stamp)
+                return;
+            track.valid = found;
+            track.markers = markers;
+            track.rotVec = rotVec;
+            track.transVec = transVec;
+            track.stamp = header.stamp;
+        }
+
+        /*
+         * Searches the smallest image first and works up to full resolution,
+         * stopping at the first level with markers. Their corners are scaled
+         * back up and refined on the full image, so they are as accurate as a
+         * full resolution detection. Gives the level the markers were found at.
+         * */
+        int detectCoarseToFine(const cv::Mat &gray, Workspace &workspace)
+        {
+            std::vector<std::vector<cv::Point2f> > &markerCorners = workspace.corners;
+            std::vector<int> &markerIds = workspace.ids;
+            const auto &params = workspace.params;
+            std::vector<cv::Mat> &pyramid = workspace.pyramid;
+            pyramid.resize(pyramidLevels + 1);
+            for (int level = 1; level <= pyramidLevels; level++)
+                cv::pyrDown(level == 1 ? gray : pyramid[level - 1], pyramid[level]);
+
+            for (int level = pyramidLevels; level > 0; level--)
+            {
+                cv::aruco::detectMarkers(pyramid[level], dictionary, markerCorners,
+                        markerIds, workspace.coarseParams);
+                if (markerIds.empty())
+                    continue;
+                // pixel centers line up at (x + 0.5) * scale - 0.5
+                float scale = static_cast<float>(1 << level);
+                int window = params->cornerRefinementWinSize + (1 << level);
+                cv::TermCriteria criteria{cv::TermCriteria::MAX_ITER | cv::TermCriteria::EPS,
+                    params->cornerRefinementMaxIterations,
+                    params->cornerRefinementMinAccuracy};
+                for (auto &corners : markerCorners)
+                {
+                    for (auto &corner : corners)
+                        corner = (corner + cv::Point2f(0.5f, 0.5f)) * scale - cv::Point2f(0.5f, 0.5f);
+                    cv::cornerSubPix(gray, corners, cv::Size(window, window),
+                            cv::Size(-1, -1), criteria);
+                }
+                return level;
+            }
+
+            cv::aruco::detectMarkers(gray, dictionary, markerCorners, markerIds, params);
+            return 0;
+        }
+
+        /*
+         * Shares the image's pixels when they are already mono8, otherwise
+         * converts into the reused gray buffer.
+         * */
+        cv::Mat toGray(const sensor_msgs::ImageConstPtr& image, Workspace &workspace)
+        {
+            namespace enc = sensor_msgs::image_encodings;
+            const std::string &encoding = image->encoding;
+            if (encoding == enc::MONO8)
+                return cv_bridge::toCvShare(image)->image;
+
+            int code = -1;
+            if (encoding == enc::BGR8)
+                code = cv::COLOR_BGR2GRAY;
+            else if (encoding == enc::RGB8)
+                code = cv::COLOR_RGB2GRAY;
+            else if (encoding == enc::BGRA8)
+                code = cv::COLOR_BGRA2GRAY;
+            else if (encoding == enc::RGBA8)
+                code = cv::COLOR_RGBA2GRAY;
+            if (code < 0)
+                return cv_bridge::toCvShare(image, enc::MONO8)->image;
+
+            cv::cvtColor(cv_bridge::toCvShare(image)->image, workspace.gray, code);
+            return workspace.gray;
+        }
+
+        /*
+         * Mean pixel distance between the detected corners of the board's
+         * markers and where the estimated board pose puts them.
+         * */
+        double reprojectionError(const std::vector<std::vector<cv::Point2f> > &corners,
+                const std::vector<int> &ids, const cv::Mat &cameraMatrix,
+                const cv::Mat &distCoeffs, const cv::Vec3d &rotVec,
+                const cv::Vec3d &transVec, std::vector<cv::Point2f> &projected)
+        {
+            double total = 0;
+            int count = 0;
+            for (size_t i = 0; i < ids.size(); i++)
+            {
+                auto match = std::find(board->ids.begin(), board->ids.end(), ids[i]);
+                if (match == board->ids.end())
+                    continue;
+                auto &objectPoints = board->objPoints[match - board->ids.begin()];
+                cv::projectPoints(objectPoints, rotVec, transVec, cameraMatrix,
+                        distCoeffs, projected);
+                for (size_t j = 0; j < projected.size() && j < corners[i].size(); j++)
+                {
+                    total += cv::norm(projected[j] - corners[i][j]);
+                    count++;
+                }
+            }
+            return (count > 0) ? total / count : 0;
+        }
+
+        /*
+         * Angle between the board's normal and the line of sight from the
+         * camera to the board, 0 when looking at the board head on.
+         * */
+        double viewingAngle(const cv::Vec3d &rotVec, const cv::Vec3d &transVec)
+        {
+            cv::Matx33d rotation;
+            cv::Rodrigues(rotVec, rotation);
+            cv::Vec3d normal = rotation * cv::Vec3d(0, 0, 1);
+            double distance = cv::norm(transVec);
+            if (distance == 0)
+                return 0;
+            double alignment = std::abs(normal.dot(transVec)) / distance;
+            return std::acos(std::min(alignment, 1.0));
+        }
+
+        static constexpr double PI = 3.1415;
+};
+
+/*
+ * Accepts any number of goals at once and hands them to a fixed pool of
+ * workers, each with its own workspace, so the fiducial odometry, localization
+ * and dumping are detected in parallel instead of queueing behind each other.
+ * Goals are served oldest first, a goal canceled while queued is dropped.
+ *
+ * Goals without an image are served from the camera, if there is one, and
+ * aborted when it has no frame that fits the goal's mode and stamp (yet).
+ * */
+class ArucoServer
+{
+    public:
+        ArucoServer(ros::NodeHandle &n, const std::string &name, TFR_Aruco &detector,
+                int workerCount, const ImageWrapper *c = nullptr) :
+            aruco(detector),
+            camera{c},
+            server{n, name, boost::bind(&ArucoServer::queueGoal, this, _1), false},
+            stopping{false}
+        {
+            for (int i = 0; i < workerCount; i++)
+                workers.emplace_back(&ArucoServer::work, this);
+            server.start();
+        }
+        ~ArucoServer()
+        {
+            {
+                std::lock_guard<std::mutex> lock(queueMutex);
+                stopping = true;
+            }
+            queueReady.notify_all();
+            for (auto &worker : workers)
+                worker.join();
+        }
+        ArucoServer(const ArucoServer&) = delete;
+        ArucoServer& operator=(const ArucoServer&) = delete;
+        ArucoServer(ArucoServer&&) = delete;
+        ArucoServer& operator=(ArucoServer&&) = delete;
+
+    private:
+        TFR_Aruco &aruco;
+        const ImageWrapper *camera;
+        Server server;
+        std::deque<GoalHandle> queue;
+        std::mutex queueMutex;
+        std::condition_variable queueReady;
+        bool stopping;
+        std::vector<std::thread> workers;
+
+        void queueGoal(GoalHandle goal)
+        {
+            goal.setAccepted();
+            {
+                std::lock_guard<std::mutex> lock(queueMutex);
+                queue.push_back(goal);
+            }
+            queueReady.notify_one();
+        }
+
+        /*
+         * The goal's own image, sharing the goal instead of copying it, or
+         * the camera's frame. False if there is neither.
+         * */
+        bool findImage(const tfr_msgs::ArucoGoalConstPtr &goal,
+                sensor_msgs::ImageConstPtr &image, sensor_msgs::CameraInfoConstPtr &info)
+        {
+            if (!goal->image.data.empty())
+            {
+                image = sensor_msgs::ImageConstPtr(goal, &goal->image);
+                info = sensor_msgs::CameraInfoConstPtr(goal, &goal->camera_info);
+                return true;
+            }
+            ImageWrapper::Frame frame{};
+            if (camera == nullptr || !camera->lookup(goal->mode, goal->stamp, frame))
+                return false;
+            image = frame.image;
+            info = frame.info;
+            return true;
+        }
+
+        void work()
+        {
+            Workspace workspace = aruco.makeWorkspace();
+            while (true)
+            {
+                GoalHandle goal;
+                {
+                    std::unique_lock<std::mutex> lock(queueMutex);
+                    queueReady.wait(lock, [this] { return stopping || !queue.empty(); });
+                    if (stopping)
+                        return;
+                    goal = queue.front();
+                    queue.pop_front();
+                }
+                if (goal.getGoalStatus().status == actionlib_msgs::GoalStatus::PREEMPTING)
+                {
+                    goal.setCanceled();
+                    continue;
+                }
+                tfr_msgs::ArucoResult result;
+                sensor_msgs::ImageConstPtr image{};
+                sensor_msgs::CameraInfoConstPtr info{};
+                if (!findImage(goal.getGoal(), image, info))
+                    goal.setAborted(result);
+                else if (aruco.execute(image, *info, workspace, result))
+                    goal.setSucceeded(result);
+                else
+                    goal.setAborted(result);
+            }
+        }
+};
+
+#endif
@@ -97,6 +97,7 @@ void setup()
 
 void loop()
 {
+    arduinoReading.header.stamp = nh.now();
     arduinoReading.tread_left_vel = gearbox_left.getVelocity() * GEARBOX_MPR;
     arduinoReading.arm_turntable_pos = turntable.getPosition()  * TURNTABLE_RPR;
 
@@ -0,0 +1,76 @@
+/****************************************************************************************
+ * File:            drivebase_commander.h
+ *
+ * Purpose:         This class converts a Twist message from /cmd_vel to the linear
+ *                  velocity of the two motor sets (left and right), handling the
+ *                  calculations for differential steering.
+ *
+ *                  Unlike the DrivebasePublisher this class is not a node, and lives in
+ *                  the control node. Instead of publishing to the tread velocity
+ *                  controllers it hands the setpoints straight to them through the
+ *                  controller manager, so a twist reaches the hardware on the next
+ *                  iteration of the control loop.
+ *
+ * Subscribed To:   /cmd_vel
+ * Commands:        left_tread_velocity_controller
+ *                  right_tread_velocity_controller
+ ***************************************************************************************/
+#ifndef DRIVEBASE_COMMANDER_H
+#define DRIVEBASE_COMMANDER_H
+
+#include <ros/ros.h>
+#include <geometry_msgs/Twist.h>
+#include <controller_manager/controller_manager.h>
+#include <mutex>
+#include <utility>
+
+namespace tfr_control
+{
+    class DrivebaseCommander
+    {
+    public:
+        DrivebaseCommander() = delete;
+        explicit DrivebaseCommander(ros::NodeHandle& n, double wheel_span);
+        DrivebaseCommander(const DrivebaseCommander& other) = delete;
+        DrivebaseCommander(DrivebaseCommander&&) = delete;
+
+        ~DrivebaseCommander() = default;
+
+        DrivebaseCommander& operator=(const DrivebaseCommander&) = delete;
+        DrivebaseCommander& operator=(DrivebaseCommander&&) = delete;
+
+        /*
+         * Hands the most recent tread setpoints to the velocity controllers,
+         * call once per control loop before updating the controllers.
+         * */
+        void update(controller_manager::ControllerManager& manager);
+
+        /*
+         * Differential steering, gives the (left, right) tread velocities in
+         * meters per second for a twist.
+         * */
+        static std::pair<double, double> toTreadVelocities(
+                const geometry_msgs::Twist& twist, double wheel_span)
+        {
+            return std::make_pair(
+                    twist.linear.x - (wheel_span * twist.angular.z) / 2,
+                    twist.linear.x + (wheel_span * twist.angular.z) / 2);
+        }
+
+    private:
+        void subscriptionCallback(const geometry_msgs::Twist::ConstPtr& msg);
+
+        void setCommand(controller_manager::ControllerManager& manager,
+                const std::string& name, double velocity);
+
+        const double wheel_span;
+
+        ros::Subscriber subscriber;
+
+        //written by the spinner thread, read by the control loop
+        std::mutex command_mutex;
+        std::pair<double, double> command;
+    };
+}
+
+#endif // DRIVEBASE_COMMANDER_H
@@ -8,6 +8,10 @@
  *                  Every message read from /cmd_vel will result in two messages sent,
  *                  one to each motor controller. This class will only publish after
  *                  reading a message on /cmd_vel.
+ *
+ *                  The control node does this conversion in process through the
+ *                  DrivebaseCommander, this node is only needed when the tread
+ *                  controllers are run without it.
  * 
  * Subscribed To:   /cmd_vel
  * Publishes To:    /left_tread_velocity_controller/command
@@ -21,11 +21,14 @@
 #include <hardware_interface/robot_hw.h>
 #include <utility>
 #include <algorithm>
+#include <cmath>
 #include <tfr_msgs/ArduinoAReading.h>
 #include <tfr_msgs/ArduinoBReading.h>
 #include <tfr_msgs/PwmCommand.h>
 #include <tfr_utilities/control_code.h>
+#include <tfr_utilities/tread_synchronizer.h>
 #include <vector>
+#include <mutex>
 
 namespace tfr_control {
 
@@ -108,6 +111,12 @@ namespace tfr_control {
         bool enabled;
         tfr_msgs::ArduinoAReadingConstPtr latest_arduino_a;
         tfr_msgs::ArduinoBReadingConstPtr latest_arduino_b;
+        //the arduino a reading arm velocities were last estimated from
+        tfr_msgs::ArduinoAReadingConstPtr previous_arduino_a;
+        ros::Time previous_arduino_a_time;
+        //lines up the tread velocities from the two arduinos
+        TreadSynchronizer tread_synchronizer;
+        std::mutex tread_mutex;
 
         double turntable_offset;
 
@@ -141,6 +150,11 @@ namespace tfr_control {
          * */
         double angleToPWM(const double &desired, const double &measured);
 
+        /**
+         * Scales down the PWM output of an arm joint as it nears its soft limit
+         * */
+        double limitPWM(const Joint &joint, const double &pwm);
+
         /**
          * Gets the PWM appropriate output for turntable at the current time
          * */
@@ -9,6 +9,10 @@
  *
  * PARAMETERS:
  *  ~rate: in hz how fast we want to run the control loop (double, default:10)
+ *  /wheel_span: the separation of the tread centers in meters, shared with
+ *  drivebase odometry (double, default: 0.5588)
+ * SUBSCRIBED TOPICS:
+ *  /cmd_vel - drivebase velocity, converted to tread setpoints in this process
  * SERVICES:
  *  /toggle_control - uses the empty service, needs to be explicitly turned on to work
  *  /toggle_motors - uses the empty service, needs to be explicitly turned on to work
@@ -27,6 +31,7 @@
 #include <controller_manager/controller_manager.h>
 #include "robot_interface.h"
 #include "bin_control_server.h"
+#include "drivebase_commander.h"
 
 
 
@@ -86,9 +91,10 @@ void initializeTestCode(ros::NodeHandle& n)
 class Control
 {
     public:
-        Control(ros::NodeHandle &n, const double& rate):
+        Control(ros::NodeHandle &n, const double& rate, const double& wheel_span):
             robot_interface{n, use_fake_values, lower_limits, upper_limits},
             controller_interface{&robot_interface},
+            drivebase_commander{n, wheel_span},
             eStopControl{n.advertiseService("toggle_control", &Control::toggleControl,this)},
             eStopMotors{n.advertiseService("toggle_motors", &Control::toggleControl,this)},
             binService{n.advertiseService("bin_state", &Control::getBinState,this)},
@@ -105,6 +111,8 @@ class Control
         {
             //update from hardware
             robot_interface.read();
+            //hand the latest twist to the tread controllers
+            drivebase_commander.update(controller_interface);
             //update controllers
             controller_interface.update(ros::Time::now(), cycle);
             if (!enabled)
@@ -121,6 +129,9 @@ class Control
         //the controller layer
         controller_manager::ControllerManager controller_interface;
 
+        //cmd_vel -> tread setpoints
+        tfr_control::DrivebaseCommander drivebase_commander;
+
         //emergency stop
         ros::ServiceServer eStopControl;
         ros::ServiceServer eStopMotors;
@@ -201,8 +212,14 @@ int main(int argc, char **argv)
     ros::init(argc, argv, "control");
     ros::NodeHandle n;
 
-    double rate;
+    double rate, wheel_span;
     ros::param::param<double>("~rate", rate, 30.0);
+    ros::param::param<double>("/wheel_span", wheel_span, 0.5588);
+    if (wheel_span <= 0)
+    {
+        ROS_ERROR("Parameter 'wheel_span' must be a positive value.");
+        return 1;
+    }
 
     //test code
     if (use_fake_values)
@@ -213,7 +230,7 @@ int main(int argc, char **argv)
     ros::AsyncSpinner spinner(1);
     spinner.start();
 
-    Control control{n, rate};
+    Control control{n, rate, wheel_span};
 
     while (ros::ok())
     {
@@ -19,7 +19,7 @@ int main(int argc, char **argv)
     
     double wheel_span, wheel_radius;
 
-    ros::param::param<double>("~wheel_span", wheel_span, 1);
+    ros::param::param<double>("/wheel_span", wheel_span, 0.5588);
     if (wheel_span <= 0)
     {
         ROS_ERROR("Parameter 'wheel_span' must be a positive value.");
@@ -0,0 +1,52 @@
+/****************************************************************************************
+ * File:            drivebase_commander.cpp
+ *
+ * Purpose:         This is the implementation file for the DrivebaseCommander class.
+ *                  See tfr_control/include/tfr_control/drivebase_commander.h for details.
+ ***************************************************************************************/
+#include "drivebase_commander.h"
+#include <effort_controllers/joint_velocity_controller.h>
+
+namespace tfr_control
+{
+    DrivebaseCommander::DrivebaseCommander(ros::NodeHandle& n, double wheel_span) :
+        wheel_span{wheel_span}, command{std::make_pair(0, 0)}
+    {
+        subscriber = n.subscribe("cmd_vel", 5, &DrivebaseCommander::subscriptionCallback, this);
+    }
+
+    void DrivebaseCommander::update(controller_manager::ControllerManager& manager)
+    {
+        std::pair<double, double> velocities;
+        {
+            std::lock_guard<std::mutex> lock(command_mutex);
+            velocities = command;
+        }
+        setCommand(manager, "left_tread_velocity_controller", velocities.first);
+        setCommand(manager, "right_tread_velocity_controller", velocities.second);
+    }
+
+    void DrivebaseCommander::subscriptionCallback(const geometry_msgs::Twist::ConstPtr& msg)
+    {
+        auto velocities = toTreadVelocities(*msg, wheel_span);
+        std::lock_guard<std::mutex> lock(command_mutex);
+        command = velocities;
+    }
+
+    /*
+     * The controllers are loaded by the spawner after we start, and can be
+     * reloaded at any time, so they are looked up every cycle instead of held.
+     * */
+    void DrivebaseCommander::setCommand(controller_manager::ControllerManager& manager,
+            const std::string& name, double velocity)
+    {
+        auto controller = dynamic_cast<effort_controllers::JointVelocityController*>(
+                manager.getControllerByName(name));
+        if (controller == nullptr)
+        {
+            ROS_WARN_THROTTLE(5, "DrivebaseCommander: %s is not loaded", name.c_str());
+            return;
+        }
+        controller->setCommand(velocity);
+    }
+}
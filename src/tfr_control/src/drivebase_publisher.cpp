@@ -5,11 +5,12 @@
  *                  See tfr_control/include/tfr_control/drivebase_publisher.h for details.
  ***************************************************************************************/
 #include "drivebase_publisher.h"
+#include "drivebase_commander.h"
 
 namespace tfr_control
 {
     DrivebasePublisher::DrivebasePublisher(
-        ros::NodeHandle& n, double wheel_radius, double wheel_span) : 
+        ros::NodeHandle& n, double wheel_span, double wheel_radius) : 
         n{n}, wheel_radius{wheel_radius}, wheel_span{wheel_span}, 
         left_tread_publisher{}, right_tread_publisher{}
     {
@@ -25,13 +26,12 @@ namespace tfr_control
     void DrivebasePublisher::subscriptionCallback(const geometry_msgs::Twist::ConstPtr& msg)
     {
 
-        double left_velocity = msg->linear.x - (wheel_span * msg->angular.z) / 2;
-        double right_velocity = msg->linear.x + (wheel_span * msg->angular.z) / 2;
+        auto velocities = DrivebaseCommander::toTreadVelocities(*msg, wheel_span);
 
         std_msgs::Float64 left_cmd;
-        left_cmd.data = left_velocity;
+        left_cmd.data = velocities.first;
         std_msgs::Float64 right_cmd;
-        right_cmd.data = right_velocity;
+        right_cmd.data = velocities.second;
         left_tread_publisher.publish(left_cmd);
         right_tread_publisher.publish(right_cmd);
     }
@@ -65,14 +65,42 @@ namespace tfr_control
         if (latest_arduino_b != nullptr)
             reading_b = *latest_arduino_b;
 
+        //the arm potentiometers only give position, so velocity is estimated
+        //from consecutive readings, it is needed to brake near the limits
+        double d_t = 0;
+        tfr_msgs::ArduinoAReading previous_a;
+        auto now = ros::Time::now();
+        if (latest_arduino_a != previous_arduino_a)
+        {
+            if (previous_arduino_a != nullptr)
+            {
+                previous_a = *previous_arduino_a;
+                d_t = (now - previous_arduino_a_time).toSec();
+            }
+            previous_arduino_a = latest_arduino_a;
+            previous_arduino_a_time = now;
+        }
+
+        //the treads are read by different arduinos, so they are paired at
+        //the newest instant both have reported instead of taken as is
+        TreadSynchronizer::Sample treads{};
+        {
+            std::lock_guard<std::mutex> lock(tread_mutex);
+            if (!tread_synchronizer.latest(treads))
+            {
+                treads.left = -reading_a.tread_left_vel;
+                treads.right = reading_b.tread_right_vel;
+            }
+        }
+
         //LEFT_TREAD
         position_values[static_cast<int>(Joint::LEFT_TREAD)] = 0;
-        velocity_values[static_cast<int>(Joint::LEFT_TREAD)] = -reading_a.tread_left_vel;
+        velocity_values[static_cast<int>(Joint::LEFT_TREAD)] = treads.left;
         effort_values[static_cast<int>(Joint::LEFT_TREAD)] = 0;
 
         //RIGHT_TREAD
         position_values[static_cast<int>(Joint::RIGHT_TREAD)] = 0;
-        velocity_values[static_cast<int>(Joint::RIGHT_TREAD)] = reading_b.tread_right_vel;
+        velocity_values[static_cast<int>(Joint::RIGHT_TREAD)] = treads.right;
         effort_values[static_cast<int>(Joint::RIGHT_TREAD)] = 0;
 
         if (!use_fake_values)
@@ -85,17 +113,23 @@ namespace tfr_control
 
             //LOWER_ARM
             position_values[static_cast<int>(Joint::LOWER_ARM)] = reading_a.arm_lower_pos;
-            velocity_values[static_cast<int>(Joint::LOWER_ARM)] = 0;
+            if (d_t > 0)
+                velocity_values[static_cast<int>(Joint::LOWER_ARM)] =
+                    (reading_a.arm_lower_pos - previous_a.arm_lower_pos)/d_t;
             effort_values[static_cast<int>(Joint::LOWER_ARM)] = 0;
 
             //UPPER_ARM
             position_values[static_cast<int>(Joint::UPPER_ARM)] = reading_a.arm_upper_pos;
-            velocity_values[static_cast<int>(Joint::UPPER_ARM)] = 0;
+            if (d_t > 0)
+                velocity_values[static_cast<int>(Joint::UPPER_ARM)] =
+                    (reading_a.arm_upper_pos - previous_a.arm_upper_pos)/d_t;
             effort_values[static_cast<int>(Joint::UPPER_ARM)] = 0;
 
             //SCOOP
             position_values[static_cast<int>(Joint::SCOOP)] = reading_a.arm_scoop_pos;
-            velocity_values[static_cast<int>(Joint::SCOOP)] = 0;
+            if (d_t > 0)
+                velocity_values[static_cast<int>(Joint::SCOOP)] =
+                    (reading_a.arm_scoop_pos - previous_a.arm_scoop_pos)/d_t;
             effort_values[static_cast<int>(Joint::SCOOP)] = 0;
         }
  
@@ -116,6 +150,9 @@ namespace tfr_control
      *
      * The controller gives a command value to move them as one, then we scale
      * our pwm outputs to move them back into sync if they get out of wack.
+     *
+     * The arm joints are braked as they near their soft limits, so the rest of
+     * the stroke can run at full speed.
      * */
     void RobotInterface::write() 
     {
@@ -148,21 +185,21 @@ namespace tfr_control
 
             //LOWER_ARM
             //NOTE we reverse these because actuator is mounted backwards
-            signal = -angleToPWM(command_values[static_cast<int>(Joint::LOWER_ARM)],
+            signal = angleToPWM(command_values[static_cast<int>(Joint::LOWER_ARM)],
                         position_values[static_cast<int>(Joint::LOWER_ARM)]);
-            command.arm_lower = signal;
+            command.arm_lower = -limitPWM(Joint::LOWER_ARM, signal);
 
 
             //UPPER_ARM
             signal = angleToPWM(command_values[static_cast<int>(Joint::UPPER_ARM)],
                         position_values[static_cast<int>(Joint::UPPER_ARM)]);
-            command.arm_upper = signal;
+            command.arm_upper = limitPWM(Joint::UPPER_ARM, signal);
 
 
             //SCOOP
             signal = angleToPWM(command_values[static_cast<int>(Joint::SCOOP)],
                         position_values[static_cast<int>(Joint::SCOOP)]);
-            command.arm_scoop = signal;
+            command.arm_scoop = limitPWM(Joint::SCOOP, signal);
 
          }
 
@@ -329,6 +366,62 @@ namespace tfr_control
         return 0;
     }
 
+    /*
+     * Input is the pwm output for an arm joint, positive toward its upper
+     * limit, and output is that pwm capped so the joint can still stop at its
+     * limit from the model.
+     *
+     * The cap follows the braking curve v = sqrt(2*a*d) for the distance left
+     * to the limit, and if the measured velocity already needs more room than
+     * is left to stop, the output is cut entirely. Poses at the limit itself
+     * stay reachable, angleToPWM lets go within min_delta of them.
+     * */
+    double RobotInterface::limitPWM(const Joint &joint, const double &pwm)
+    {
+        //we don't anticipate these changing very much keep at method level
+        //deceleration of a joint with the pwm cut rad/s^2
+        double max_deceleration = 1.0;
+        //velocity of a joint at full pwm rad/s
+        double max_velocity = 0.6;
+
+        double lower, upper;
+        switch (joint)
+        {
+            case Joint::LOWER_ARM:
+                lower = tfr_utilities::JointAngle::ARM_LOWER_MIN;
+                upper = tfr_utilities::JointAngle::ARM_LOWER_MAX;
+                break;
+            case Joint::UPPER_ARM:
+                lower = tfr_utilities::JointAngle::ARM_UPPER_MIN;
+                upper = tfr_utilities::JointAngle::ARM_UPPER_MAX;
+                break;
+            case Joint::SCOOP:
+                lower = tfr_utilities::JointAngle::ARM_SCOOP_MIN;
+                upper = tfr_utilities::JointAngle::ARM_SCOOP_MAX;
+                break;
+            default:
+                return pwm;
+        }
+
+        if (pwm == 0)
+            return 0;
+
+        int sign = (pwm < 0) ? -1 : 1;
+        double position = position_values[static_cast<int>(joint)];
+        double remaining = (sign > 0) ? upper - position : position - lower;
+        if (remaining <= 0)
+            return 0;
+
+        //only motion toward the limit needs to be braked
+        double approach = std::max(sign * velocity_values[static_cast<int>(joint)], 0.0);
+        double stopping_distance = approach * approach / (2 * max_deceleration);
+        if (stopping_distance >= remaining)
+            return 0;
+
+        double allowed = std::sqrt(2 * max_deceleration * remaining) / max_velocity;
+        return sign * std::min(std::abs(pwm), allowed);
+    }
+
     /*
      * Input is angle desired/measured of a twin acutuator joint and output is
      * in raw pwm frequency for both of them. The actuator further ahead get's
@@ -427,6 +520,9 @@ namespace tfr_control
     void RobotInterface::readArduinoA(const tfr_msgs::ArduinoAReadingConstPtr &msg)
     {
         latest_arduino_a = msg;
+        auto stamp = msg->header.stamp.isZero() ? ros::Time::now() : msg->header.stamp;
+        std::lock_guard<std::mutex> lock(tread_mutex);
+        tread_synchronizer.addLeft(stamp, -msg->tread_left_vel);
     }
 
     /*
@@ -435,6 +531,9 @@ namespace tfr_control
     void RobotInterface::readArduinoB(const tfr_msgs::ArduinoBReadingConstPtr &msg)
     {
         latest_arduino_b = msg;
+        auto stamp = msg->header.stamp.isZero() ? ros::Time::now() : msg->header.stamp;
+        std::lock_guard<std::mutex> lock(tread_mutex);
+        tread_synchronizer.addRight(stamp, msg->tread_right_vel);
     }
 
     void RobotInterface::zeroTurntable()
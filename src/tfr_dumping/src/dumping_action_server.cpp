@@ -3,7 +3,6 @@
 #include <std_msgs/Float64.h>
 #include <tfr_msgs/EmptyAction.h>
 #include <tfr_msgs/ArucoAction.h>
-#include <tfr_msgs/WrappedImage.h>
 #include <tfr_msgs/BinStateSrv.h>
 #include <tfr_utilities/control_code.h>
 #include <tfr_utilities/arm_manipulator.h>
@@ -23,10 +22,10 @@
  *
  * It stops when the light detector get's triggered.
  *
- * It requires a service where it can get the most recent image on demand for
- * the camera of interest for backing up. 
+ * It requires the aruco detector in the manager of the camera of interest for
+ * backing up, which detects in that camera's newest frame.
  *
- * This is currently filled by the camera_topic_wrapper in sensors
+ * This is currently filled by the aruco nodelets in sensors
  *
  * published topics:
  *   -/cmd_vel geometry_msgs/Twist the drivebase velocity
@@ -54,14 +53,13 @@ class Dumper
         };
 
         
-        Dumper(ros::NodeHandle &node, const std::string &service_name,
+        Dumper(ros::NodeHandle &node, const std::string &aruco_name,
                 const DumpingConstraints &c) :
             server{node, "dump", boost::bind(&Dumper::dump, this, _1), false},
-            image_client{node.serviceClient<tfr_msgs::WrappedImage>(service_name)},
             velocity_publisher{node.advertise<geometry_msgs::Twist>("cmd_vel", 10)},
             bin_publisher{node.advertise<std_msgs::Float64>("/bin_position_controller/command", 10)},
             detector{"light_detection"},
-            aruco{"aruco_action_server",true},
+            aruco{aruco_name,true},
             constraints{c},
             arm_manipulator{node}
         {
@@ -83,7 +81,8 @@ class Dumper
         actionlib::SimpleActionClient<tfr_msgs::EmptyAction> detector;
         actionlib::SimpleActionClient<tfr_msgs::ArucoAction> aruco;
 
-        ros::ServiceClient image_client;
+        //capture time of the last frame we ran detection on
+        ros::Time last_image_stamp{};
         ros::Publisher velocity_publisher;
         ros::Publisher bin_publisher;
 
@@ -250,17 +249,23 @@ class Dumper
          */
         void getArucoEstimate(tfr_msgs::ArucoResult &result)
         {
-            tfr_msgs::WrappedImage image_request{};
             tfr_msgs::ArucoGoal goal{};
-            while (!image_client.call(image_request));
-
-            goal.image = image_request.response.image;
-            goal.camera_info = image_request.response.camera_info;
-            
-            aruco.sendGoal(goal);
-            aruco.waitForResult();
+            //the newest frame, but never run detection on the same frame twice,
+            //the detector aborts until a newer one is captured
+            goal.mode = tfr_msgs::ArucoGoal::NEWEST_AFTER;
+            goal.stamp = last_image_stamp;
+            ros::Duration busy_wait{0.01};
+            while (true)
+            {
+                aruco.sendGoal(goal);
+                aruco.waitForResult();
+                if (aruco.getState() == actionlib::SimpleClientGoalState::SUCCEEDED)
+                    break;
+                busy_wait.sleep();
+            }
 
             result = *aruco.getResult();
+            last_image_stamp = result.image_stamp;
         }
 };
 
@@ -279,11 +284,12 @@ int main(int argc, char **argv)
     ros::param::param<double>("~min_ang_vel",min_ang_vel, 0);
     ros::param::param<double>("~max_ang_vel",max_ang_vel, 0);
     ros::param::param<double>("~ang_tolerance",ang_tolerance, 0);
-    std::string service_name;
-    ros::param::param<std::string>("~image_service_name", service_name, "");
+    std::string aruco_name;
+    ros::param::param<std::string>("~aruco_action_name", aruco_name,
+            "/sensors/rear_cam/aruco");
     Dumper::DumpingConstraints constraints(min_lin_vel, max_lin_vel,
             min_ang_vel, max_ang_vel, ang_tolerance);
-    Dumper dumper(n, service_name, constraints);
+    Dumper dumper(n, aruco_name, constraints);
     ros::spin();
     return 0;
 }
@@ -4,8 +4,8 @@
  * Takes in the empty action request, and provides no feedback.
  * Turns until it sees the aruco markers, exits succesfully once it does.
  *
- * Needs access to the image wrapper topic wrapper to fetch images, 
- * name is specified as a parameter.
+ * Needs the aruco detectors in the rear and front camera managers, which
+ * detect in their own camera's frames.
  *
  * parameters:
  *  - ~turn_speed: how fast to turn [rad/s] (double, default: 0.0)
@@ -20,7 +20,6 @@
 #include <actionlib/server/simple_action_server.h>
 #include <tfr_msgs/ArucoAction.h>
 #include <tfr_msgs/LocalizationAction.h>
-#include <tfr_msgs/WrappedImage.h>
 #include <tfr_msgs/PoseSrv.h>
 #include <tfr_utilities/tf_manipulator.h>
 #include <geometry_msgs/Twist.h>
@@ -30,7 +29,8 @@ class Localizer
     public:
         Localizer(ros::NodeHandle &n, const double& velocity, const double&
                 duration, const double& thresh) : 
-            aruco{n, "aruco_action_server"},
+            rear_aruco{n, "/sensors/rear_cam/aruco"},
+            front_aruco{n, "/sensors/front_cam/aruco"},
             server{n, "localize", boost::bind(&Localizer::localize, this, _1) ,false},
             cmd_publisher{n.advertise<geometry_msgs::Twist>("cmd_vel", 5)},
             turn_velocity{velocity},
@@ -39,19 +39,9 @@ class Localizer
 
         {
             ROS_INFO("Localization Action Server: Connecting Aruco");
-            aruco.waitForServer();
+            rear_aruco.waitForServer();
+            front_aruco.waitForServer();
             ROS_INFO("Localization Action Server: Connected Aruco");
-
-            ROS_INFO("Localization Action Server: Connecting Image Client");
-            rear_cam_client = n.serviceClient<tfr_msgs::WrappedImage>("/on_demand/rear_cam/image_raw");
-            front_cam_client = n.serviceClient<tfr_msgs::WrappedImage>("/on_demand/front_cam/image_raw");
-            tfr_msgs::WrappedImage request{};
-            ros::Duration busy_wait{0.1};
-            while(!rear_cam_client.call(request)) 
-                busy_wait.sleep();
-            while(!front_cam_client.call(request))
-                busy_wait.sleep();
-            ROS_INFO("Localization Action Server: Connected Image Clients");
             ROS_INFO("Localization Action Server: Starting");
             server.start();
             ROS_INFO("Localization Action Server: Started");
@@ -63,10 +53,9 @@ class Localizer
         Localizer& operator=(Localizer&&) = delete;
     private:
         actionlib::SimpleActionServer<tfr_msgs::LocalizationAction> server;
-        actionlib::SimpleActionClient<tfr_msgs::ArucoAction> aruco;
+        actionlib::SimpleActionClient<tfr_msgs::ArucoAction> rear_aruco;
+        actionlib::SimpleActionClient<tfr_msgs::ArucoAction> front_aruco;
         ros::Publisher cmd_publisher;
-        ros::ServiceClient rear_cam_client;
-        ros::ServiceClient front_cam_client;
         TfManipulator tf_manipulator;
         const double& turn_velocity;
         const double& turn_duration;
@@ -86,6 +75,8 @@ class Localizer
                     odometry, goal->target_yaw);
 
             tfr_msgs::LocalizationResult output;
+            //only look at frames captured after the robot stopped turning
+            ros::Time settled = ros::Time::now();
             //loop
             while (true)
             {
@@ -98,16 +89,17 @@ class Localizer
                     success = false;
                     break;
                 }
-                tfr_msgs::ArucoResultConstPtr result = nullptr;
-                tfr_msgs::WrappedImage image_wrapper{};
-                if (rear_cam_client.call(image_wrapper))
-                    result = sendAruco(image_wrapper);
-                ROS_INFO("Localization Action Server: rearcam %d", result->number_found);
+                //either camera can come up without a frame, the turn goes on
+                tfr_msgs::ArucoResultConstPtr result = detect(rear_aruco, settled);
+                if (result != nullptr)
+                    ROS_INFO("Localization Action Server: rearcam %d", result->number_found);
 
-                if (result != nullptr && result->number_found == 0 && front_cam_client.call(image_wrapper))
-                    result = sendAruco(image_wrapper);
-
-                ROS_INFO("Localization Action Server: frontcam %d", result->number_found);
+                if (result == nullptr || result->number_found == 0)
+                {
+                    result = detect(front_aruco, settled);
+                    if (result != nullptr)
+                        ROS_INFO("Localization Action Server: frontcam %d", result->number_found);
+                }
                 if (result != nullptr && result->number_found > 0)
                 {
                     //we found something
@@ -181,6 +173,7 @@ class Localizer
                 cmd.angular.z = 0;
                 cmd_publisher.publish(cmd);
                 ros::Duration(turn_duration).sleep();
+                settled = ros::Time::now();
             }
 
             if (success)
@@ -192,15 +185,28 @@ class Localizer
             ROS_INFO("Localization Action Server: Localize Finished");
         }
 
-        tfr_msgs::ArucoResultConstPtr sendAruco(const tfr_msgs::WrappedImage& msg)
+        /*
+         * Detects in the first frame the camera captured after the stamp,
+         * waiting up to a second for the camera to deliver one. The detector
+         * aborts while it has no such frame. Null if none came.
+         * */
+        tfr_msgs::ArucoResultConstPtr detect(
+                actionlib::SimpleActionClient<tfr_msgs::ArucoAction>& aruco,
+                const ros::Time& after)
         {
             tfr_msgs::ArucoGoal goal;
-            goal.image = msg.response.image;
-            goal.camera_info = msg.response.camera_info;
-            //send it to the server
-            aruco.sendGoal(goal);
-            aruco.waitForResult();
-            return aruco.getResult();
+            goal.mode = tfr_msgs::ArucoGoal::NEWER_THAN;
+            goal.stamp = after;
+            ros::Duration busy_wait{0.02};
+            for (int attempt = 0; attempt < 50; ++attempt)
+            {
+                aruco.sendGoal(goal);
+                aruco.waitForResult();
+                if (aruco.getState() == actionlib::SimpleClientGoalState::SUCCEEDED)
+                    return aruco.getResult();
+                busy_wait.sleep();
+            }
+            return nullptr;
         }
 
 
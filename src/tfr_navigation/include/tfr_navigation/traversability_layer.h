@@ -0,0 +1,57 @@
+/* Costmap layer that paints the traversability grid from the elevation
+ * mapper in tfr_sensor into the costmaps. The arena memory publishes the same
+ * kind of grid, and gets a second instance of this layer.
+ *
+ * Grid values of 100 are lethal, anything lower is scaled below the inscribed
+ * cost, so rough ground is avoided when there is a way around but can still be
+ * planned through. Unknown cells are left to the other layers. The grid has to
+ * be in the costmap's global frame.
+ *
+ * Parameters (in the layer's namespace):
+ *   topic: the traversability grid (string, default: "/sensors/kinect/traversability")
+ * */
+#ifndef TRAVERSABILITY_LAYER_H
+#define TRAVERSABILITY_LAYER_H
+
+#include <ros/ros.h>
+#include <costmap_2d/layer.h>
+#include <costmap_2d/costmap_2d.h>
+#include <nav_msgs/OccupancyGrid.h>
+#include <mutex>
+
+namespace tfr_navigation
+{
+    class TraversabilityLayer : public costmap_2d::Layer
+    {
+        public:
+            TraversabilityLayer() = default;
+            ~TraversabilityLayer() = default;
+            TraversabilityLayer(const TraversabilityLayer&) = delete;
+            TraversabilityLayer& operator=(const TraversabilityLayer&) = delete;
+            TraversabilityLayer(TraversabilityLayer&&) = delete;
+            TraversabilityLayer& operator=(TraversabilityLayer&&) = delete;
+
+            void onInitialize() override;
+
+            void updateBounds(double robot_x, double robot_y, double robot_yaw,
+                    double* min_x, double* min_y, double* max_x, double* max_y) override;
+
+            void updateCosts(costmap_2d::Costmap2D& master_grid,
+                    int min_i, int min_j, int max_i, int max_j) override;
+
+        private:
+            void gridCallback(const nav_msgs::OccupancyGridConstPtr& msg);
+
+            ros::Subscriber subscriber;
+
+            //the subscriber and the costmap update run on different threads
+            std::mutex grid_mutex;
+            nav_msgs::OccupancyGridConstPtr grid;
+
+            //the area painted last time, it has to be repainted when the grid moves
+            bool painted{false};
+            double painted_min_x{}, painted_min_y{}, painted_max_x{}, painted_max_y{};
+    };
+}
+
+#endif
@@ -0,0 +1,353 @@
+/**
+ * Remembers obstacles for the whole arena, so they outlive the rolling
+ * costmaps and carry over between legs of a mission and between missions.
+ *
+ * The memory is a fixed grid anchored to the bin, so it stays put in the arena
+ * no matter how odom drifts or gets reset. Cells gain a hit every time the
+ * obstacle cloud lands in them or the traversability grid calls them lethal,
+ * and lose one every time the traversability grid sees them as drivable. Cells
+ * with at least min_hits are obstacles.
+ *
+ * The obstacles are republished once a second as a traversability style grid
+ * in odom around the robot, for a TraversabilityLayer in the costmaps. The
+ * memory is saved to a small binary file periodically, on request and on
+ * shutdown, and loaded at startup.
+ *
+ * File format (native byte order): "TFRA", uint32 version, uint32 width,
+ * uint32 height, float resolution, float origin x, float origin y, then
+ * width*height uint8 hit counts, row major.
+ *
+ * parameters:
+ *   ~bin_frame: (string, default: "bin_footprint")
+ *   ~odom_frame: (string, default: "odom")
+ *   ~base_frame: (string, default: "base_footprint")
+ *   ~file: where the memory is kept (string, default: "~/.ros/arena_memory.bin")
+ *   ~resolution: [m] (double, default: 0.1)
+ *   ~min_x, ~min_y, ~max_x, ~max_y: arena bounds in the bin frame [m]
+ *   (double, default: -1, -5, 9, 5)
+ *   ~min_hits: hits before a cell is an obstacle (int, default: 5)
+ *   ~window: side of the published grid [m] (double, default: 16)
+ *   ~save_period: [s] (double, default: 30)
+ * subscribed topics:
+ *   obstacles (sensor_msgs/PointCloud2)
+ *   traversability (nav_msgs/OccupancyGrid)
+ * published topics:
+ *   arena_memory (nav_msgs/OccupancyGrid)
+ * services:
+ *   save_arena_memory (std_srvs/Empty)
+ *   clear_arena_memory (std_srvs/Empty) - forgets everything, for a new arena
+ * */
+#include <ros/ros.h>
+#include <nav_msgs/OccupancyGrid.h>
+#include <sensor_msgs/PointCloud2.h>
+#include <sensor_msgs/point_cloud2_iterator.h>
+#include <std_srvs/Empty.h>
+#include <tf2_ros/buffer.h>
+#include <tf2_ros/transform_listener.h>
+#include <tf2_geometry_msgs/tf2_geometry_msgs.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+class ArenaMemory
+{
+    public:
+        struct Parameters
+        {
+            std::string bin_frame;
+            std::string odom_frame;
+            std::string base_frame;
+            std::string file;
+            double resolution;
+            double min_x;
+            double min_y;
+            double max_x;
+            double max_y;
+            int min_hits;
+            double window;
+            double save_period;
+        };
+
+        ArenaMemory(ros::NodeHandle& n, const Parameters& p) :
+            parameters(p),
+            width{static_cast<uint32_t>(std::ceil((p.max_x - p.min_x) / p.resolution))},
+            height{static_cast<uint32_t>(std::ceil((p.max_y - p.min_y) / p.resolution))},
+            hits(width * height, 0),
+            tf_buffer{},
+            tf_listener{tf_buffer}
+        {
+            if (load())
+                ROS_INFO("Arena Memory: loaded %s", parameters.file.c_str());
+            publisher = n.advertise<nav_msgs::OccupancyGrid>("arena_memory", 1, true);
+            obstacle_subscriber = n.subscribe("obstacles", 2,
+                    &ArenaMemory::processObstacles, this);
+            traversability_subscriber = n.subscribe("traversability", 2,
+                    &ArenaMemory::processTraversability, this);
+            save_service = n.advertiseService("save_arena_memory",
+                    &ArenaMemory::saveService, this);
+            clear_service = n.advertiseService("clear_arena_memory",
+                    &ArenaMemory::clearService, this);
+            publish_timer = n.createTimer(ros::Duration(1.0), &ArenaMemory::publish, this);
+            save_timer = n.createTimer(ros::Duration(parameters.save_period),
+                    &ArenaMemory::periodicSave, this);
+        }
+
+        ~ArenaMemory()
+        {
+            save();
+        }
+        ArenaMemory(const ArenaMemory&) = delete;
+        ArenaMemory& operator=(const ArenaMemory&) = delete;
+        ArenaMemory(ArenaMemory&&) = delete;
+        ArenaMemory& operator=(ArenaMemory&&) = delete;
+
+    private:
+        const Parameters parameters;
+        const uint32_t width;
+        const uint32_t height;
+        //saturating hit counts, row major from (min_x, min_y)
+        std::vector<uint8_t> hits;
+
+        ros::Publisher publisher;
+        ros::Subscriber obstacle_subscriber;
+        ros::Subscriber traversability_subscriber;
+        ros::ServiceServer save_service;
+        ros::ServiceServer clear_service;
+        ros::Timer publish_timer;
+        ros::Timer save_timer;
+        tf2_ros::Buffer tf_buffer;
+        tf2_ros::TransformListener tf_listener;
+
+        const char MAGIC[4] = {'T', 'F', 'R', 'A'};
+        const uint32_t VERSION = 1;
+
+        //index of the cell under a point in the bin frame, -1 off the arena
+        int cellIndex(double x, double y) const
+        {
+            int i = static_cast<int>(std::floor((x - parameters.min_x) / parameters.resolution));
+            int j = static_cast<int>(std::floor((y - parameters.min_y) / parameters.resolution));
+            if (i < 0 || j < 0 || i >= static_cast<int>(width) || j >= static_cast<int>(height))
+                return -1;
+            return j * width + i;
+        }
+
+        //false if the bin hasn't been localized yet
+        bool lookup(const std::string& target, const std::string& source,
+                const ros::Time& stamp, tf2::Transform& transform)
+        {
+            try
+            {
+                auto stamped = tf_buffer.lookupTransform(target, source, stamp,
+                        ros::Duration(0.1));
+                tf2::fromMsg(stamped.transform, transform);
+                return true;
+            }
+            catch (tf2::TransformException &ex)
+            {
+                ROS_WARN_THROTTLE(10, "Arena Memory: %s", ex.what());
+                return false;
+            }
+        }
+
+        void processObstacles(const sensor_msgs::PointCloud2ConstPtr& cloud)
+        {
+            tf2::Transform transform{};
+            if (!lookup(parameters.bin_frame, cloud->header.frame_id,
+                        cloud->header.stamp, transform))
+                return;
+            //one hit per cell per cloud, however many points land in it
+            std::vector<int> marked{};
+            sensor_msgs::PointCloud2ConstIterator<float> x{*cloud, "x"}, y{*cloud, "y"}, z{*cloud, "z"};
+            for (; x != x.end(); ++x, ++y, ++z)
+            {
+                auto p = transform(tf2::Vector3{*x, *y, *z});
+                int cell = cellIndex(p.x(), p.y());
+                if (cell >= 0)
+                    marked.push_back(cell);
+            }
+            std::sort(marked.begin(), marked.end());
+            marked.erase(std::unique(marked.begin(), marked.end()), marked.end());
+            for (auto cell : marked)
+                if (hits[cell] < UINT8_MAX)
+                    ++hits[cell];
+        }
+
+        /*
+         * Lethal cells are hits, drivable ones (under half cost) take hits
+         * away, so things that were never really there fade out.
+         * */
+        void processTraversability(const nav_msgs::OccupancyGridConstPtr& grid)
+        {
+            tf2::Transform transform{};
+            if (!lookup(parameters.bin_frame, grid->header.frame_id,
+                        grid->header.stamp, transform))
+                return;
+            const auto &info = grid->info;
+            for (uint32_t j = 0; j < info.height; ++j)
+                for (uint32_t i = 0; i < info.width; ++i)
+                {
+                    int8_t value = grid->data[j * info.width + i];
+                    if (value < 0)
+                        continue;
+                    auto p = transform(tf2::Vector3{
+                            info.origin.position.x + (i + 0.5) * info.resolution,
+                            info.origin.position.y + (j + 0.5) * info.resolution, 0});
+                    int cell = cellIndex(p.x(), p.y());
+                    if (cell < 0)
+                        continue;
+                    if (value >= 100 && hits[cell] < UINT8_MAX)
+                        ++hits[cell];
+                    else if (value < 50 && hits[cell] > 0)
+                        --hits[cell];
+                }
+        }
+
+        /*
+         * Resamples the remembered obstacles into an odom aligned grid around
+         * the robot, what the costmap layer expects.
+         * */
+        void publish(const ros::TimerEvent&)
+        {
+            ros::Time now = ros::Time::now();
+            tf2::Transform odom_to_bin{}, robot{};
+            if (!lookup(parameters.bin_frame, parameters.odom_frame, ros::Time(0), odom_to_bin) ||
+                    !lookup(parameters.odom_frame, parameters.base_frame, ros::Time(0), robot))
+                return;
+
+            const int cells = static_cast<int>(std::ceil(parameters.window / parameters.resolution));
+            auto grid = boost::make_shared<nav_msgs::OccupancyGrid>();
+            grid->header.stamp = now;
+            grid->header.frame_id = parameters.odom_frame;
+            grid->info.map_load_time = now;
+            grid->info.resolution = parameters.resolution;
+            grid->info.width = cells;
+            grid->info.height = cells;
+            grid->info.origin.position.x = std::floor(robot.getOrigin().x() /
+                    parameters.resolution - cells / 2) * parameters.resolution;
+            grid->info.origin.position.y = std::floor(robot.getOrigin().y() /
+                    parameters.resolution - cells / 2) * parameters.resolution;
+            grid->info.origin.orientation.w = 1;
+            grid->data.assign(cells * cells, -1);
+
+            for (int j = 0; j < cells; ++j)
+                for (int i = 0; i < cells; ++i)
+                {
+                    auto p = odom_to_bin(tf2::Vector3{
+                            grid->info.origin.position.x + (i + 0.5) * parameters.resolution,
+                            grid->info.origin.position.y + (j + 0.5) * parameters.resolution, 0});
+                    int cell = cellIndex(p.x(), p.y());
+                    if (cell >= 0 && hits[cell] >= parameters.min_hits)
+                        grid->data[j * cells + i] = 100;
+                }
+            publisher.publish(grid);
+        }
+
+        void periodicSave(const ros::TimerEvent&)
+        {
+            save();
+        }
+
+        bool saveService(std_srvs::Empty::Request&, std_srvs::Empty::Response&)
+        {
+            return save();
+        }
+
+        bool clearService(std_srvs::Empty::Request&, std_srvs::Empty::Response&)
+        {
+            ROS_INFO("Arena Memory: clearing");
+            std::fill(hits.begin(), hits.end(), 0);
+            return save();
+        }
+
+        bool save()
+        {
+            std::ofstream file{parameters.file, std::ios::binary | std::ios::trunc};
+            if (!file)
+            {
+                ROS_WARN_THROTTLE(30, "Arena Memory: can't write %s", parameters.file.c_str());
+                return false;
+            }
+            float resolution = parameters.resolution;
+            float origin_x = parameters.min_x, origin_y = parameters.min_y;
+            file.write(MAGIC, sizeof(MAGIC));
+            file.write(reinterpret_cast<const char*>(&VERSION), sizeof(VERSION));
+            file.write(reinterpret_cast<const char*>(&width), sizeof(width));
+            file.write(reinterpret_cast<const char*>(&height), sizeof(height));
+            file.write(reinterpret_cast<const char*>(&resolution), sizeof(resolution));
+            file.write(reinterpret_cast<const char*>(&origin_x), sizeof(origin_x));
+            file.write(reinterpret_cast<const char*>(&origin_y), sizeof(origin_y));
+            file.write(reinterpret_cast<const char*>(hits.data()), hits.size());
+            return static_cast<bool>(file);
+        }
+
+        /*
+         * Only takes a file made with the same grid, anything else is ignored
+         * and gets overwritten on the next save.
+         * */
+        bool load()
+        {
+            std::ifstream file{parameters.file, std::ios::binary};
+            if (!file)
+                return false;
+            char magic[4];
+            uint32_t version, file_width, file_height;
+            float resolution, origin_x, origin_y;
+            file.read(magic, sizeof(magic));
+            file.read(reinterpret_cast<char*>(&version), sizeof(version));
+            file.read(reinterpret_cast<char*>(&file_width), sizeof(file_width));
+            file.read(reinterpret_cast<char*>(&file_height), sizeof(file_height));
+            file.read(reinterpret_cast<char*>(&resolution), sizeof(resolution));
+            file.read(reinterpret_cast<char*>(&origin_x), sizeof(origin_x));
+            file.read(reinterpret_cast<char*>(&origin_y), sizeof(origin_y));
+            if (!file || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+                    version != VERSION || file_width != width || file_height != height ||
+                    resolution != static_cast<float>(parameters.resolution) ||
+                    origin_x != static_cast<float>(parameters.min_x) ||
+                    origin_y != static_cast<float>(parameters.min_y))
+            {
+                ROS_WARN("Arena Memory: %s doesn't match this arena, ignoring it",
+                        parameters.file.c_str());
+                return false;
+            }
+            std::vector<uint8_t> loaded(hits.size());
+            file.read(reinterpret_cast<char*>(loaded.data()), loaded.size());
+            if (!file)
+                return false;
+            hits.swap(loaded);
+            return true;
+        }
+};
+
+int main(int argc, char** argv)
+{
+    ros::init(argc, argv, "arena_memory");
+    ros::NodeHandle n;
+
+    ArenaMemory::Parameters parameters{};
+    std::string home = std::getenv("HOME") != nullptr ? std::getenv("HOME") : ".";
+    ros::param::param<std::string>("~bin_frame", parameters.bin_frame, "bin_footprint");
+    ros::param::param<std::string>("~odom_frame", parameters.odom_frame, "odom");
+    ros::param::param<std::string>("~base_frame", parameters.base_frame, "base_footprint");
+    ros::param::param<std::string>("~file", parameters.file, home + "/.ros/arena_memory.bin");
+    ros::param::param<double>("~resolution", parameters.resolution, 0.1);
+    ros::param::param<double>("~min_x", parameters.min_x, -1.0);
+    ros::param::param<double>("~min_y", parameters.min_y, -5.0);
+    ros::param::param<double>("~max_x", parameters.max_x, 9.0);
+    ros::param::param<double>("~max_y", parameters.max_y, 5.0);
+    ros::param::param<int>("~min_hits", parameters.min_hits, 5);
+    ros::param::param<double>("~window", parameters.window, 16.0);
+    ros::param::param<double>("~save_period", parameters.save_period, 30.0);
+    if (parameters.resolution <= 0 || parameters.max_x <= parameters.min_x ||
+            parameters.max_y <= parameters.min_y || parameters.save_period <= 0)
+    {
+        ROS_ERROR("Arena Memory: bad arena bounds, resolution or save period");
+        return 1;
+    }
+
+    ArenaMemory memory{n, parameters};
+    ros::spin();
+    return 0;
+}
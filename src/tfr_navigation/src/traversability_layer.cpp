@@ -0,0 +1,107 @@
+#include "traversability_layer.h"
+#include <pluginlib/class_list_macros.h>
+#include <algorithm>
+#include <cmath>
+
+PLUGINLIB_EXPORT_CLASS(tfr_navigation::TraversabilityLayer, costmap_2d::Layer)
+
+namespace tfr_navigation
+{
+    void TraversabilityLayer::onInitialize()
+    {
+        ros::NodeHandle nh("~/" + name_);
+        std::string topic;
+        nh.param<std::string>("topic", topic, "/sensors/kinect/traversability");
+        nh.param<bool>("enabled", enabled_, true);
+        current_ = true;
+        subscriber = nh.subscribe(topic, 1, &TraversabilityLayer::gridCallback, this);
+    }
+
+    void TraversabilityLayer::gridCallback(const nav_msgs::OccupancyGridConstPtr& msg)
+    {
+        if (msg->header.frame_id != layered_costmap_->getGlobalFrameID() &&
+                "/" + msg->header.frame_id != layered_costmap_->getGlobalFrameID())
+        {
+            ROS_WARN_THROTTLE(5, "TraversabilityLayer: grid is in %s, costmap is in %s",
+                    msg->header.frame_id.c_str(),
+                    layered_costmap_->getGlobalFrameID().c_str());
+            return;
+        }
+        std::lock_guard<std::mutex> lock(grid_mutex);
+        grid = msg;
+    }
+
+    void TraversabilityLayer::updateBounds(double robot_x, double robot_y,
+            double robot_yaw, double* min_x, double* min_y, double* max_x, double* max_y)
+    {
+        if (!enabled_)
+            return;
+        std::lock_guard<std::mutex> lock(grid_mutex);
+        if (grid == nullptr)
+            return;
+
+        const auto &info = grid->info;
+        double grid_min_x = info.origin.position.x;
+        double grid_min_y = info.origin.position.y;
+        double grid_max_x = grid_min_x + info.width * info.resolution;
+        double grid_max_y = grid_min_y + info.height * info.resolution;
+
+        //cover where the grid was too, so stale costs get cleared
+        double lower_x = grid_min_x, lower_y = grid_min_y;
+        double upper_x = grid_max_x, upper_y = grid_max_y;
+        if (painted)
+        {
+            lower_x = std::min(lower_x, painted_min_x);
+            lower_y = std::min(lower_y, painted_min_y);
+            upper_x = std::max(upper_x, painted_max_x);
+            upper_y = std::max(upper_y, painted_max_y);
+        }
+        *min_x = std::min(*min_x, lower_x);
+        *min_y = std::min(*min_y, lower_y);
+        *max_x = std::max(*max_x, upper_x);
+        *max_y = std::max(*max_y, upper_y);
+
+        painted = true;
+        painted_min_x = grid_min_x;
+        painted_min_y = grid_min_y;
+        painted_max_x = grid_max_x;
+        painted_max_y = grid_max_y;
+    }
+
+    void TraversabilityLayer::updateCosts(costmap_2d::Costmap2D& master_grid,
+            int min_i, int min_j, int max_i, int max_j)
+    {
+        if (!enabled_)
+            return;
+        nav_msgs::OccupancyGridConstPtr current;
+        {
+            std::lock_guard<std::mutex> lock(grid_mutex);
+            current = grid;
+        }
+        if (current == nullptr)
+            return;
+
+        const auto &info = current->info;
+        const int width = info.width, height = info.height;
+        for (int j = min_j; j < max_j; ++j)
+            for (int i = min_i; i < max_i; ++i)
+            {
+                double wx, wy;
+                master_grid.mapToWorld(i, j, wx, wy);
+                int gx = static_cast<int>(std::floor((wx - info.origin.position.x) / info.resolution));
+                int gy = static_cast<int>(std::floor((wy - info.origin.position.y) / info.resolution));
+                if (gx < 0 || gy < 0 || gx >= width || gy >= height)
+                    continue;
+                int8_t value = current->data[gy * width + gx];
+                if (value < 0)
+                    continue;
+
+                unsigned char cost = value >= 100 ? costmap_2d::LETHAL_OBSTACLE :
+                    static_cast<unsigned char>(value *
+                            (costmap_2d::INSCRIBED_INFLATED_OBSTACLE - 1) / 100);
+                unsigned char old_cost = master_grid.getCost(i, j);
+                if (old_cost == costmap_2d::NO_INFORMATION || cost > old_cost)
+                    master_grid.setCost(i, j, cost);
+            }
+    }
+}
@@ -0,0 +1,78 @@
+/* Turns the kinect depth image straight into a laser scan of obstacles.
+ *
+ * Every sampled pixel is projected with a ray table built once per camera
+ * info, moved into the robot frame, and kept only if it falls in the
+ * obstacle height band. The nearest kept point in each bearing becomes that
+ * bearing's range. Bearings where only floor was seen get +inf, so the
+ * costmaps clear them, and bearings with no valid depth get nan and are left
+ * alone. No point cloud is ever built.
+ *
+ * Depth is looked up relative to sensor_frame, set it to the tilt corrected
+ * frame from sensor_tilt to take the imu roll and pitch into account.
+ *
+ * Subscribed Topics:
+ *   depth (sensor_msgs/Image) 16UC1 in millimeters or 32FC1 in meters
+ *   depth/camera_info (sensor_msgs/CameraInfo)
+ * Published Topics:
+ *   scan (sensor_msgs/LaserScan)
+ * */
+#ifndef DEPTH_OBSTACLE_SCAN_H
+#define DEPTH_OBSTACLE_SCAN_H
+
+#include <ros/ros.h>
+#include <sensor_msgs/Image.h>
+#include <sensor_msgs/CameraInfo.h>
+#include <sensor_msgs/LaserScan.h>
+#include <image_transport/image_transport.h>
+#include <tf2/LinearMath/Vector3.h>
+#include <tf2_ros/buffer.h>
+#include <tf2_ros/transform_listener.h>
+#include <vector>
+
+class DepthObstacleScan
+{
+    public:
+        struct Parameters
+        {
+            std::string target_frame;
+            //empty uses the frame of the depth image
+            std::string sensor_frame;
+            double angle_min;
+            double angle_max;
+            double angle_increment;
+            double range_min;
+            double range_max;
+            //obstacle band above the target frame
+            double min_height;
+            double max_height;
+            //only every step'th row and column is looked at
+            int step;
+        };
+
+        DepthObstacleScan(ros::NodeHandle& n, const Parameters& p);
+        ~DepthObstacleScan() = default;
+        DepthObstacleScan(const DepthObstacleScan&) = delete;
+        DepthObstacleScan& operator=(const DepthObstacleScan&) = delete;
+        DepthObstacleScan(DepthObstacleScan&&) = delete;
+        DepthObstacleScan& operator=(DepthObstacleScan&&) = delete;
+
+    private:
+        void scan(const sensor_msgs::ImageConstPtr& image,
+                const sensor_msgs::CameraInfoConstPtr& info);
+
+        //rebuilds the ray table if the intrinsics or image size changed
+        void updateRays(const sensor_msgs::CameraInfo& info);
+
+        const Parameters parameters;
+
+        image_transport::CameraSubscriber subscriber;
+        ros::Publisher publisher;
+        tf2_ros::Buffer tf_buffer;
+        tf2_ros::TransformListener tf_listener;
+
+        //direction of each sampled pixel at unit depth, row major
+        std::vector<tf2::Vector3> rays;
+        sensor_msgs::CameraInfo ray_info;
+};
+
+#endif
@@ -0,0 +1,78 @@
+/* Extended kalman filter specialized for a differential drive on flat ground.
+ *
+ * The state is fixed at compile time so every matrix is a fixed size Eigen
+ * type living on the stack, and a predict/update pair costs a few hundred
+ * flops:
+ *   x, y, yaw: the pose in odom
+ *   v, omega: forward speed and turn rate in the robot frame
+ *   bias: the gyro's yaw rate bias
+ *
+ * The motion model is a unicycle with v and omega as random walks. Each
+ * sensor gets its own update with a fixed size measurement:
+ *   gyro: omega + bias
+ *   tread odometry: v and omega
+ *   fiducials: x, y and yaw
+ *
+ * Times are plain seconds so this class doesn't depend on ros.
+ * */
+#ifndef DRIVE_EKF_H
+#define DRIVE_EKF_H
+
+#include <Eigen/Dense>
+
+class DriveEkf
+{
+    public:
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+        static constexpr int SIZE = 6;
+        enum Index { X = 0, Y, YAW, V, OMEGA, BIAS };
+
+        using State = Eigen::Matrix<double, SIZE, 1>;
+        using Covariance = Eigen::Matrix<double, SIZE, SIZE>;
+
+        //how fast uncertainty grows, variance per second
+        struct Noise
+        {
+            double position;
+            double yaw;
+            double velocity;
+            double turn_rate;
+            double bias;
+        };
+
+        explicit DriveEkf(const Noise &n);
+        ~DriveEkf() = default;
+        DriveEkf(const DriveEkf&) = default;
+        DriveEkf& operator=(const DriveEkf&) = default;
+        DriveEkf(DriveEkf&&) = default;
+        DriveEkf& operator=(DriveEkf&&) = default;
+
+        void reset(const State &s, const Covariance &p);
+
+        //moves the state dt seconds forward
+        void predict(double dt);
+
+        void updateGyro(double rate, double variance);
+        void updateVelocity(double v, double omega, double v_variance,
+                double omega_variance);
+        void updatePose(double x, double y, double yaw,
+                const Eigen::Matrix3d &covariance);
+
+        const State& state() const { return s; }
+        const Covariance& covariance() const { return p; }
+
+        static double normalizeAngle(double angle);
+
+    private:
+        template <int M>
+        void update(const Eigen::Matrix<double, M, 1> &innovation,
+                const Eigen::Matrix<double, M, SIZE> &h,
+                const Eigen::Matrix<double, M, M> &r);
+
+        Noise noise;
+        State s;
+        Covariance p;
+};
+
+#endif
@@ -0,0 +1,104 @@
+/* Builds a 2.5D elevation map around the robot from the tilted depth cloud,
+ * and publishes how traversable each cell is.
+ *
+ * The map is a fixed size square of cells in the odom frame that follows the
+ * robot, shifting whole cells when the robot gets a quarter of the way to an
+ * edge. Every cloud is moved into odom and each point is binned into its cell
+ * in parallel over slices of rows on opencv's thread pool, each slice with its
+ * own accumulator. The mean height a cloud gives a cell is then blended into
+ * the cell's height, weighing the last max_observations clouds about equally.
+ *
+ * A cell's traversability cost (0 to 100, -1 unknown) is the largest height
+ * step to its neighbors relative to max_step. Cells more than max_depth below
+ * the robot are craters and get 100.
+ *
+ * Subscribed Topics:
+ *   points (sensor_msgs/PointCloud2)
+ * Published Topics:
+ *   traversability (nav_msgs/OccupancyGrid)
+ * */
+#ifndef ELEVATION_MAPPER_H
+#define ELEVATION_MAPPER_H
+
+#include <ros/ros.h>
+#include <sensor_msgs/PointCloud2.h>
+#include <nav_msgs/OccupancyGrid.h>
+#include <tf2/LinearMath/Transform.h>
+#include <tf2_ros/buffer.h>
+#include <tf2_ros/transform_listener.h>
+#include <cstdint>
+#include <vector>
+
+class ElevationMapper
+{
+    public:
+        struct Parameters
+        {
+            std::string map_frame;
+            std::string base_frame;
+            double resolution;
+            //cells per side
+            int size;
+            //points further than this from the robot are too noisy
+            double max_range;
+            //points higher than this above the robot aren't ground
+            double max_height;
+            //height step between neighbors that can't be driven over
+            double max_step;
+            //cells this far below the robot are craters
+            double max_depth;
+            int max_observations;
+            //only every step'th row and column of the cloud is used
+            int step;
+            int threads;
+        };
+
+        ElevationMapper(ros::NodeHandle& n, const Parameters& p);
+        ~ElevationMapper() = default;
+        ElevationMapper(const ElevationMapper&) = delete;
+        ElevationMapper& operator=(const ElevationMapper&) = delete;
+        ElevationMapper(ElevationMapper&&) = delete;
+        ElevationMapper& operator=(ElevationMapper&&) = delete;
+
+    private:
+        struct Accumulator
+        {
+            std::vector<float> sum;
+            std::vector<uint16_t> count;
+        };
+
+        void update(const sensor_msgs::PointCloud2ConstPtr& cloud);
+
+        //bins rows [begin, end) of the cloud into the accumulator
+        void accumulate(const sensor_msgs::PointCloud2& cloud, const int offsets[3],
+                const tf2::Transform& transform, const tf2::Vector3& robot,
+                uint32_t begin, uint32_t end, Accumulator& accumulator) const;
+
+        //shifts the map so the robot stays near the middle
+        void recenter(const tf2::Vector3& robot);
+
+        void publish(const ros::Time& stamp, const tf2::Vector3& robot);
+
+        //index of the cell under a point in the map frame, -1 if off the map
+        int cellIndex(double x, double y) const;
+
+        const Parameters parameters;
+
+        ros::Subscriber subscriber;
+        ros::Publisher publisher;
+        tf2_ros::Buffer tf_buffer;
+        tf2_ros::TransformListener tf_listener;
+
+        //the map, row major, origin is the map frame cell of cell 0
+        std::vector<float> heights;
+        std::vector<uint8_t> observations;
+        int origin_x;
+        int origin_y;
+
+        //reused every cloud, so nothing is allocated after the first one
+        std::vector<Accumulator> accumulators;
+        std::vector<float> shifted_heights;
+        std::vector<uint8_t> shifted_observations;
+};
+
+#endif
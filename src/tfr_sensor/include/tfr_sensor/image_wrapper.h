@@ -0,0 +1,81 @@
+/**
+ * wrapper for an image stream, allows the user to get a recent image from
+ * that stream on demand.
+ *
+ * The last few frames are kept in a ring buffer indexed by capture time, so
+ * besides the latest frame users can ask for the frame nearest a time, or the
+ * first frame captured after a time (e.g. after the robot stopped moving).
+ *
+ * Run as a nodelet next to the camera, frames arrive as shared pointers and
+ * are never copied while buffered. Users in the same manager (the ArUco
+ * nodelets, see tfr_aruco) look frames up directly and share them. Out of
+ * process users go through the service, which copies the requested frame
+ * into its response.
+ *
+ * Subscribed Topics:
+ * <camera_topic>: user suppplied
+ * Provided Services:
+ * <service_name>: user supplied, not advertised if empty
+ *
+ * Relevant Messages:
+ * tfr_msgs::WrappedImage (srv)
+ * */
+#ifndef IMAGE_WRAPPER_H
+#define IMAGE_WRAPPER_H
+
+#include <ros/ros.h>
+#include <sensor_msgs/Image.h>
+#include <sensor_msgs/CameraInfo.h>
+#include <image_transport/image_transport.h>
+#include <tfr_msgs/WrappedImage.h>
+#include <tfr_utilities/stamped_buffer.h>
+#include <mutex>
+
+class ImageWrapper
+{
+    public:
+        //a frame and the camera info it came with
+        struct Frame
+        {
+            sensor_msgs::ImageConstPtr image;
+            sensor_msgs::CameraInfoConstPtr info;
+        };
+
+        ImageWrapper(ros::NodeHandle &n, const std::string &camera_topic,
+                const std::string &service_name, int buffer_size);
+        ~ImageWrapper() = default;
+        ImageWrapper(const ImageWrapper&) = delete;
+        ImageWrapper& operator=(const ImageWrapper&) = delete;
+        ImageWrapper(ImageWrapper&&) = delete;
+        ImageWrapper& operator=(ImageWrapper&&) = delete;
+
+        /*
+         * Frame lookups, shared not copied. All are false until the camera
+         * has started publishing, newerThan is also false until a frame after
+         * the stamp arrives.
+         * */
+        bool latest(Frame &frame) const;
+        bool nearest(const ros::Time &stamp, Frame &frame) const;
+        bool newerThan(const ros::Time &stamp, Frame &frame) const;
+
+        //one of the above by tfr_msgs::WrappedImage request mode
+        bool lookup(uint8_t mode, const ros::Time &stamp, Frame &frame) const;
+
+    private:
+        //subscription callback
+        void set_current(const sensor_msgs::ImageConstPtr &i, const
+                sensor_msgs::CameraInfoConstPtr &in);
+
+        //service callback
+        bool get_current(tfr_msgs::WrappedImage::Request &request,
+                tfr_msgs::WrappedImage::Response &response);
+
+        image_transport::CameraSubscriber subscriber;
+        ros::ServiceServer server;
+
+        //a nodelet manager can run the callbacks on different threads
+        mutable std::mutex image_mutex;
+        StampedBuffer<Frame> frames;
+};
+
+#endif
@@ -0,0 +1,98 @@
+/* Reduces a depth cloud to the few points the costmaps care about.
+ *
+ * The costmaps only look at points within obstacle range that stand above the
+ * ground, but the kinect hands over the full 640x480 cloud. This class:
+ *  - moves the cloud into the robot frame and crops it to a box around the
+ *    robot,
+ *  - downsamples what is left to one point (the centroid) per voxel,
+ *  - fits the ground plane to the low voxels with RANSAC, and keeps only the
+ *    voxels standing between min_height and max_height above it.
+ * The transform, crop and voxel steps run in parallel over slices of rows on
+ * opencv's thread pool.
+ *
+ * The output is a packed xyz cloud in the robot frame with at most a few
+ * thousand points.
+ *
+ * Subscribed Topics:
+ *   points (sensor_msgs/PointCloud2)
+ * Published Topics:
+ *   obstacles (sensor_msgs/PointCloud2)
+ * */
+#ifndef OBSTACLE_FILTER_H
+#define OBSTACLE_FILTER_H
+
+#include <ros/ros.h>
+#include <sensor_msgs/PointCloud2.h>
+#include <tf2/LinearMath/Transform.h>
+#include <tf2_ros/buffer.h>
+#include <tf2_ros/transform_listener.h>
+#include <cstdint>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+class ObstacleFilter
+{
+    public:
+        struct Parameters
+        {
+            std::string target_frame;
+            //half the side of the crop box around the robot
+            double max_range;
+            //obstacle band above the ground plane
+            double min_height;
+            double max_height;
+            double voxel_size;
+            //voxels this close to the ground plane count as ground
+            double ground_threshold;
+            //how many slices of rows to process at once
+            int threads;
+        };
+
+        ObstacleFilter(ros::NodeHandle& n, const Parameters& p);
+        ~ObstacleFilter() = default;
+        ObstacleFilter(const ObstacleFilter&) = delete;
+        ObstacleFilter& operator=(const ObstacleFilter&) = delete;
+        ObstacleFilter(ObstacleFilter&&) = delete;
+        ObstacleFilter& operator=(ObstacleFilter&&) = delete;
+
+    private:
+        struct Voxel
+        {
+            double x;
+            double y;
+            double z;
+            int count;
+        };
+        using VoxelGrid = std::unordered_map<int64_t, Voxel>;
+
+        //a plane as n.p + d = 0, n is unit length and points up
+        struct Plane
+        {
+            tf2::Vector3 normal;
+            double d;
+        };
+
+        void filter(const sensor_msgs::PointCloud2ConstPtr& cloud);
+
+        //transform, crop and voxelize rows [begin, end) of the cloud
+        void voxelize(const sensor_msgs::PointCloud2& cloud, const int offsets[3],
+                const tf2::Transform& transform, uint32_t begin, uint32_t end,
+                VoxelGrid& grid) const;
+
+        int64_t voxelKey(double x, double y, double z) const;
+
+        //ransac over the centroids near the floor, false if no level plane fits
+        bool fitGround(const std::vector<tf2::Vector3>& points, Plane& plane);
+
+        const Parameters parameters;
+
+        ros::Subscriber subscriber;
+        ros::Publisher publisher;
+        tf2_ros::Buffer tf_buffer;
+        tf2_ros::TransformListener tf_listener;
+
+        std::mt19937 generator;
+};
+
+#endif
@@ -0,0 +1,88 @@
+/* Does pitch and roll for an obstacle detection sensor.
+ *
+ * The depth sensor is mounted rigidly, so when the robot pitches over a rock
+ * the ground shows up as an obstacle. This class rotates the xyz of every
+ * cloud by the roll and pitch the imu reports, so what comes out is gravity
+ * aligned but still expressed in the sensor (parent) frame. The parent frame
+ * has to be an optical frame (z forward, y down), the imu angles are turned
+ * into those axes. The rotation is also broadcast as parent_frame ->
+ * child_frame for anyone that wants it.
+ *
+ * Recent imu orientations are buffered and slerped to the stamp of each
+ * cloud, so the tilt matches the instant the cloud was captured instead of
+ * whichever imu message came in last. The transform is broadcast at that
+ * same stamp.
+ *
+ * The output is a packed xyz cloud written into a buffer that is reused
+ * whenever no subscriber still holds the previous one, so running this as a
+ * nodelet in the driver's manager costs one pass over the points per cloud.
+ *
+ * Subscribed Topics:
+ *   imu (sensor_msgs/Imu)
+ *   points (sensor_msgs/PointCloud2)
+ * Published Topics:
+ *   tilted_points (sensor_msgs/PointCloud2)
+ * */
+#ifndef POINT_CLOUD_TILTER_H
+#define POINT_CLOUD_TILTER_H
+
+#include <ros/ros.h>
+#include <sensor_msgs/Imu.h>
+#include <sensor_msgs/PointCloud2.h>
+#include <tf2/LinearMath/Quaternion.h>
+#include <tf2/LinearMath/Matrix3x3.h>
+#include <tf2_ros/transform_broadcaster.h>
+#include <tfr_utilities/stamped_buffer.h>
+#include <mutex>
+
+class PointCloudTilter
+{
+    public:
+        PointCloudTilter(ros::NodeHandle& n, const std::string& p_f, const std::string& c_f);
+        ~PointCloudTilter() = default;
+        PointCloudTilter(const PointCloudTilter&) = delete;
+        PointCloudTilter& operator=(const PointCloudTilter&) = delete;
+        PointCloudTilter(PointCloudTilter&&) = delete;
+        PointCloudTilter& operator=(PointCloudTilter&&) = delete;
+
+        /*
+         * Rotates the xyz fields of the cloud into a packed xyz cloud, false
+         * if the cloud has no float xyz fields.
+         * */
+        static bool rotate(const sensor_msgs::PointCloud2& in,
+                const tf2::Matrix3x3& rotation, sensor_msgs::PointCloud2& out);
+
+    private:
+        void publishTransform(const ros::Time& stamp, const tf2::Quaternion& tilt);
+
+        void tiltData(const sensor_msgs::PointCloud2ConstPtr& cloudPtr);
+
+        void storeImu(const sensor_msgs::ImuConstPtr &imu);
+
+        //the rotation that undoes the roll and pitch of the imu at the stamp
+        tf2::Quaternion getTilt(const ros::Time& stamp);
+
+        //the imu orientation at the stamp, false before any imu data
+        bool orientationAt(const ros::Time& stamp, tf2::Quaternion& orientation);
+
+        ros::Subscriber imu_subscriber;
+        ros::Subscriber data_subscriber;
+        ros::Publisher tilt_publisher;
+        const std::string parent_frame;
+        const std::string child_frame;
+        tf2_ros::TransformBroadcaster br;
+
+        //a nodelet manager can run the callbacks on different threads
+        std::mutex imu_mutex;
+        StampedBuffer<tf2::Quaternion> orientations;
+
+        //reused unless a subscriber is still holding on to it
+        sensor_msgs::PointCloud2Ptr output;
+
+        //optical x is link -y, optical y is link -z, optical z is link x
+        const tf2::Matrix3x3 LINK_TO_OPTICAL{0, -1, 0,
+            0, 0, -1,
+            1, 0, 0};
+};
+
+#endif
@@ -0,0 +1,112 @@
+/* Sparse feature stereo visual odometry for the DUO3D, on the cpu.
+ *
+ * Each rectified stereo pair is reduced to ORB features (FAST corners with
+ * binary descriptors), the left and right images in parallel. Left features
+ * are matched along the same row in the right image and triangulated from
+ * their disparity.
+ *
+ * Instead of chaining frame to frame motion, the camera is tracked against a
+ * small window of recent keyframes: their triangulated points are kept in a
+ * common world frame, the current left features are matched to all of them
+ * and the pose is solved with PnP inside RANSAC, then refined with
+ * Levenberg-Marquardt on the inliers. Errors only build up when a keyframe is
+ * added, which happens when the view has moved on enough that too few of the
+ * window's points are still seen.
+ *
+ * Only depends on OpenCV, poses are in the left camera's optical frame (x
+ * right, y down, z forward).
+ * */
+#ifndef STEREO_ODOMETRY_H
+#define STEREO_ODOMETRY_H
+
+#include <opencv2/core.hpp>
+#include <opencv2/features2d.hpp>
+#include <deque>
+#include <vector>
+
+class StereoOdometry
+{
+    public:
+        struct Parameters
+        {
+            //ORB features per image
+            int features;
+            int fast_threshold;
+            //keyframes kept to track against
+            int window;
+            //worst descriptor distance accepted for a match, out of 256 bits
+            int max_distance;
+            //best to second best match distance ratio for tracking
+            double ratio;
+            //rows searched above and below for a stereo match [px]
+            int row_tolerance;
+            double min_disparity;
+            double max_disparity;
+            //largest reprojection error of a RANSAC inlier [px]
+            double reprojection_error;
+            int min_inliers;
+            //a keyframe is added when fewer window points than this are inliers
+            int keyframe_inliers;
+        };
+
+        //rectified pinhole model, the baseline is in meters
+        struct Calibration
+        {
+            double fx;
+            double fy;
+            double cx;
+            double cy;
+            double baseline;
+        };
+
+        explicit StereoOdometry(const Parameters &p);
+        ~StereoOdometry() = default;
+        StereoOdometry(const StereoOdometry&) = delete;
+        StereoOdometry& operator=(const StereoOdometry&) = delete;
+        StereoOdometry(StereoOdometry&&) = delete;
+        StereoOdometry& operator=(StereoOdometry&&) = delete;
+
+        /*
+         * Tracks a rectified 8 bit grayscale pair. Gives the camera's motion
+         * since the last tracked pair (x_last = motion * x_now) and the inlier
+         * count. False on the first pair and whenever tracking is lost, the
+         * next pair then starts over.
+         * */
+        bool process(const cv::Mat &left, const cv::Mat &right,
+                const Calibration &calibration, cv::Matx44d &motion, int &inliers);
+
+        void reset();
+
+    private:
+        struct Keyframe
+        {
+            //world frame
+            std::vector<cv::Point3f> points;
+            cv::Mat descriptors;
+        };
+
+        static void detect(cv::ORB &detector, const cv::Mat &image,
+                std::vector<cv::KeyPoint> &keypoints, cv::Mat &descriptors);
+        //points are in the current camera frame, with one descriptor row each
+        void triangulate(const std::vector<cv::KeyPoint> &left_keypoints,
+                const cv::Mat &left_descriptors,
+                const std::vector<cv::KeyPoint> &right_keypoints,
+                const cv::Mat &right_descriptors, const Calibration &calibration,
+                std::vector<cv::Point3f> &points, cv::Mat &descriptors) const;
+        bool track(const std::vector<cv::KeyPoint> &keypoints,
+                const cv::Mat &descriptors, const Calibration &calibration,
+                cv::Matx44d &current, int &inliers) const;
+        void addKeyframe(const std::vector<cv::Point3f> &points,
+                const cv::Mat &descriptors, const cv::Matx44d &camera_to_world);
+
+        const Parameters parameters;
+        //one detector per image, so both can run at once
+        cv::Ptr<cv::ORB> left_detector;
+        cv::Ptr<cv::ORB> right_detector;
+        std::deque<Keyframe> keyframes;
+        //camera to world
+        cv::Matx44d pose;
+        bool tracking;
+};
+
+#endif
@@ -0,0 +1,139 @@
+#include "depth_obstacle_scan.h"
+#include <sensor_msgs/image_encodings.h>
+#include <tf2_geometry_msgs/tf2_geometry_msgs.h>
+#include <boost/make_shared.hpp>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+DepthObstacleScan::DepthObstacleScan(ros::NodeHandle& n, const Parameters& p) :
+    parameters(p),
+    tf_buffer{},
+    tf_listener{tf_buffer}
+{
+    publisher = n.advertise<sensor_msgs::LaserScan>("scan", 5);
+    image_transport::ImageTransport it{n};
+    subscriber = it.subscribeCamera("depth", 2, &DepthObstacleScan::scan, this);
+}
+
+void DepthObstacleScan::scan(const sensor_msgs::ImageConstPtr& image,
+        const sensor_msgs::CameraInfoConstPtr& info)
+{
+    namespace enc = sensor_msgs::image_encodings;
+    bool millimeters = image->encoding == enc::TYPE_16UC1 || image->encoding == enc::MONO16;
+    if (!millimeters && image->encoding != enc::TYPE_32FC1)
+    {
+        ROS_WARN_THROTTLE(5, "DepthObstacleScan: unsupported encoding %s",
+                image->encoding.c_str());
+        return;
+    }
+    if (image->is_bigendian)
+        return;
+    updateRays(*info);
+    if (rays.empty())
+        return;
+    if (image->width != ray_info.width || image->height != ray_info.height)
+    {
+        ROS_WARN_THROTTLE(5, "DepthObstacleScan: image and camera info sizes differ");
+        return;
+    }
+
+    const auto &sensor_frame = parameters.sensor_frame.empty() ?
+        image->header.frame_id : parameters.sensor_frame;
+    tf2::Transform transform{};
+    try
+    {
+        auto stamped = tf_buffer.lookupTransform(parameters.target_frame,
+                sensor_frame, image->header.stamp, ros::Duration(0.1));
+        tf2::fromMsg(stamped.transform, transform);
+    }
+    catch (tf2::TransformException &ex)
+    {
+        ROS_WARN_THROTTLE(5, "DepthObstacleScan: %s", ex.what());
+        return;
+    }
+
+    auto output = boost::make_shared<sensor_msgs::LaserScan>();
+    output->header.stamp = image->header.stamp;
+    output->header.frame_id = parameters.target_frame;
+    output->angle_min = parameters.angle_min;
+    output->angle_max = parameters.angle_max;
+    output->angle_increment = parameters.angle_increment;
+    output->range_min = parameters.range_min;
+    output->range_max = parameters.range_max;
+    auto bins = static_cast<std::size_t>(std::ceil(
+                (parameters.angle_max - parameters.angle_min) / parameters.angle_increment)) + 1;
+    //nan until something is seen in that direction
+    output->ranges.assign(bins, std::numeric_limits<float>::quiet_NaN());
+
+    const uint32_t step = parameters.step;
+    auto ray = rays.begin();
+    for (uint32_t v = 0; v < image->height; v += step)
+    {
+        const uint8_t *row = image->data.data() + v * image->step;
+        for (uint32_t u = 0; u < image->width; u += step, ++ray)
+        {
+            double depth;
+            if (millimeters)
+            {
+                uint16_t raw;
+                std::memcpy(&raw, row + 2 * u, sizeof(raw));
+                depth = raw * 0.001;
+            }
+            else
+            {
+                float raw;
+                std::memcpy(&raw, row + 4 * u, sizeof(raw));
+                depth = raw;
+            }
+            if (!(depth > 0) || !std::isfinite(depth))
+                continue;
+
+            auto point = transform(*ray * depth);
+            double range = std::hypot(point.x(), point.y());
+            if (range < parameters.range_min || range > parameters.range_max)
+                continue;
+            double angle = std::atan2(point.y(), point.x());
+            if (angle < parameters.angle_min || angle > parameters.angle_max)
+                continue;
+            auto &bin = output->ranges[static_cast<std::size_t>(
+                    (angle - parameters.angle_min) / parameters.angle_increment)];
+
+            if (point.z() < parameters.min_height)
+            {
+                //floor, the bearing is clear unless an obstacle says otherwise
+                if (std::isnan(bin))
+                    bin = std::numeric_limits<float>::infinity();
+            }
+            else if (point.z() <= parameters.max_height)
+            {
+                if (std::isnan(bin) || range < bin)
+                    bin = range;
+            }
+        }
+    }
+    publisher.publish(output);
+}
+
+/*
+ * The ray through pixel (u, v) at unit depth in the optical frame, for the
+ * sampled pixels only.
+ * */
+void DepthObstacleScan::updateRays(const sensor_msgs::CameraInfo& info)
+{
+    if (!rays.empty() && info.width == ray_info.width &&
+            info.height == ray_info.height && info.K == ray_info.K)
+        return;
+    rays.clear();
+    double fx = info.K[0], fy = info.K[4], cx = info.K[2], cy = info.K[5];
+    if (fx <= 0 || fy <= 0)
+    {
+        ROS_WARN_THROTTLE(5, "DepthObstacleScan: camera is not calibrated");
+        return;
+    }
+    const uint32_t step = parameters.step;
+    for (uint32_t v = 0; v < info.height; v += step)
+        for (uint32_t u = 0; u < info.width; u += step)
+            rays.emplace_back((u - cx) / fx, (v - cy) / fy, 1.0);
+    ray_info = info;
+}
@@ -0,0 +1,63 @@
+/**
+ * Nodelet for the DepthObstacleScan, see
+ * tfr_sensor/include/tfr_sensor/depth_obstacle_scan.h. Load it into the depth
+ * driver's manager so the depth images are never serialized.
+ *
+ * Parameters:
+ * ~target_frame: the frame the scan is in (string, default: "base_footprint")
+ * ~sensor_frame: the frame depth is measured in (string, default: the image's)
+ * ~angle_min, ~angle_max: bearings covered [rad] (double, default: -0.5, 0.5)
+ * ~angle_increment: bearing resolution [rad] (double, default: 0.01)
+ * ~range_min, ~range_max: ranges kept [m] (double, default: 0.45, 4.0)
+ * ~min_height, ~max_height: obstacle band [m] (double, default: 0.11, 1.0)
+ * ~step: pixel step in each direction (int, default: 2)
+ * */
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+#include <algorithm>
+#include <memory>
+#include "depth_obstacle_scan.h"
+
+namespace tfr_sensor
+{
+    class DepthObstacleScanNodelet : public nodelet::Nodelet
+    {
+        public:
+            DepthObstacleScanNodelet() = default;
+            ~DepthObstacleScanNodelet() = default;
+            DepthObstacleScanNodelet(const DepthObstacleScanNodelet&) = delete;
+            DepthObstacleScanNodelet& operator=(const DepthObstacleScanNodelet&) = delete;
+            DepthObstacleScanNodelet(DepthObstacleScanNodelet&&) = delete;
+            DepthObstacleScanNodelet& operator=(DepthObstacleScanNodelet&&) = delete;
+
+        private:
+            void onInit() override
+            {
+                auto &pn = getPrivateNodeHandle();
+                DepthObstacleScan::Parameters parameters{};
+                pn.param<std::string>("target_frame", parameters.target_frame, "base_footprint");
+                pn.param<std::string>("sensor_frame", parameters.sensor_frame, "");
+                pn.param<double>("angle_min", parameters.angle_min, -0.5);
+                pn.param<double>("angle_max", parameters.angle_max, 0.5);
+                pn.param<double>("angle_increment", parameters.angle_increment, 0.01);
+                pn.param<double>("range_min", parameters.range_min, 0.45);
+                pn.param<double>("range_max", parameters.range_max, 4.0);
+                pn.param<double>("min_height", parameters.min_height, 0.11);
+                pn.param<double>("max_height", parameters.max_height, 1.0);
+                pn.param<int>("step", parameters.step, 2);
+                parameters.step = std::max(parameters.step, 1);
+                if (parameters.angle_increment <= 0 || parameters.angle_max <= parameters.angle_min)
+                {
+                    NODELET_WARN("DepthObstacleScan: bad angles, using the defaults");
+                    parameters.angle_min = -0.5;
+                    parameters.angle_max = 0.5;
+                    parameters.angle_increment = 0.01;
+                }
+                scan.reset(new DepthObstacleScan{getNodeHandle(), parameters});
+            }
+
+            std::unique_ptr<DepthObstacleScan> scan;
+    };
+}
+
+PLUGINLIB_EXPORT_CLASS(tfr_sensor::DepthObstacleScanNodelet, nodelet::Nodelet)
@@ -0,0 +1,99 @@
+#include "drive_ekf.h"
+#include <cmath>
+
+constexpr int DriveEkf::SIZE;
+
+DriveEkf::DriveEkf(const Noise &n) :
+    noise(n), s{State::Zero()}, p{Covariance::Identity()}
+{ }
+
+void DriveEkf::reset(const State &state, const Covariance &covariance)
+{
+    s = state;
+    s(YAW) = normalizeAngle(s(YAW));
+    p = covariance;
+}
+
+void DriveEkf::predict(double dt)
+{
+    if (dt <= 0)
+        return;
+    double c = std::cos(s(YAW)), sn = std::sin(s(YAW));
+
+    //jacobian of the unicycle model
+    Covariance f = Covariance::Identity();
+    f(X, YAW) = -s(V) * sn * dt;
+    f(X, V) = c * dt;
+    f(Y, YAW) = s(V) * c * dt;
+    f(Y, V) = sn * dt;
+    f(YAW, OMEGA) = dt;
+
+    s(X) += s(V) * c * dt;
+    s(Y) += s(V) * sn * dt;
+    s(YAW) = normalizeAngle(s(YAW) + s(OMEGA) * dt);
+
+    State q{};
+    q << noise.position, noise.position, noise.yaw, noise.velocity,
+        noise.turn_rate, noise.bias;
+    p = f * p * f.transpose();
+    p.diagonal() += q * dt;
+}
+
+void DriveEkf::updateGyro(double rate, double variance)
+{
+    Eigen::Matrix<double, 1, SIZE> h = Eigen::Matrix<double, 1, SIZE>::Zero();
+    h(0, OMEGA) = 1;
+    h(0, BIAS) = 1;
+    Eigen::Matrix<double, 1, 1> innovation{rate - s(OMEGA) - s(BIAS)};
+    Eigen::Matrix<double, 1, 1> r{variance};
+    update<1>(innovation, h, r);
+}
+
+void DriveEkf::updateVelocity(double v, double omega, double v_variance,
+        double omega_variance)
+{
+    Eigen::Matrix<double, 2, SIZE> h = Eigen::Matrix<double, 2, SIZE>::Zero();
+    h(0, V) = 1;
+    h(1, OMEGA) = 1;
+    Eigen::Matrix<double, 2, 1> innovation{v - s(V), omega - s(OMEGA)};
+    Eigen::Matrix<double, 2, 2> r = Eigen::Matrix<double, 2, 2>::Zero();
+    r(0, 0) = v_variance;
+    r(1, 1) = omega_variance;
+    update<2>(innovation, h, r);
+}
+
+void DriveEkf::updatePose(double x, double y, double yaw,
+        const Eigen::Matrix3d &covariance)
+{
+    Eigen::Matrix<double, 3, SIZE> h = Eigen::Matrix<double, 3, SIZE>::Zero();
+    h(0, X) = 1;
+    h(1, Y) = 1;
+    h(2, YAW) = 1;
+    //the yaw error has to go the short way around
+    Eigen::Matrix<double, 3, 1> innovation{x - s(X), y - s(Y),
+        normalizeAngle(yaw - s(YAW))};
+    update<3>(innovation, h, covariance);
+}
+
+/*
+ * Standard kalman update, with the joseph form for the covariance so it stays
+ * symmetric and positive through thousands of updates a second.
+ * */
+template <int M>
+void DriveEkf::update(const Eigen::Matrix<double, M, 1> &innovation,
+        const Eigen::Matrix<double, M, SIZE> &h,
+        const Eigen::Matrix<double, M, M> &r)
+{
+    Eigen::Matrix<double, M, M> innovation_covariance = h * p * h.transpose() + r;
+    Eigen::Matrix<double, SIZE, M> gain =
+        p * h.transpose() * innovation_covariance.inverse();
+    s += gain * innovation;
+    s(YAW) = normalizeAngle(s(YAW));
+    Covariance i_kh = Covariance::Identity() - gain * h;
+    p = i_kh * p * i_kh.transpose() + gain * r * gain.transpose();
+}
+
+double DriveEkf::normalizeAngle(double angle)
+{
+    return std::atan2(std::sin(angle), std::cos(angle));
+}
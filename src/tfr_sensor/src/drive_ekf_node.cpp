@@ -0,0 +1,249 @@
+/**
+ * Fuses the imu, tread odometry, visual odometry and fiducial odometry into the odom ->
+ * base_footprint transform, see tfr_sensor/include/tfr_sensor/drive_ekf.h
+ * for the filter itself.
+ *
+ * Every measurement is applied as it arrives: the filter is predicted up to
+ * its stamp and updated. Measurements older than the filter are applied at
+ * the filter's time. Fiducial poses come in late, stamped when their images
+ * were taken, so they are first moved forward by how far the filter says the
+ * robot went since. The transform and odometry are published on a timer.
+ *
+ * parameters:
+ *   ~frequency: how often to publish [Hz] (double, default: 100)
+ *   ~odom_frame: (string, default: "odom")
+ *   ~base_frame: (string, default: "base_footprint")
+ *   ~position_noise, ~yaw_noise, ~velocity_noise, ~turn_rate_noise,
+ *   ~bias_noise: process noise [variance/s] (double)
+ *   ~gyro_variance: used when the imu doesn't report one (double, default: 1e-4)
+ * subscribed topics:
+ *   imu (sensor_msgs/Imu) - only the yaw rate is used
+ *   drivebase_odom (nav_msgs/Odometry) - only the twist is used
+ *   visual_odom (nav_msgs/Odometry) - only the twist is used
+ *   fiducial_odom (nav_msgs/Odometry) - only x, y and yaw are used
+ * published topics:
+ *   odometry/filtered (nav_msgs/Odometry)
+ *   tf: odom_frame -> base_frame
+ * */
+#include <ros/ros.h>
+#include <nav_msgs/Odometry.h>
+#include <sensor_msgs/Imu.h>
+#include <geometry_msgs/TransformStamped.h>
+#include <tf2/LinearMath/Quaternion.h>
+#include <tf2/LinearMath/Matrix3x3.h>
+#include <tf2_ros/transform_broadcaster.h>
+#include <tfr_utilities/stamped_buffer.h>
+#include <algorithm>
+#include <cmath>
+#include "drive_ekf.h"
+
+class DriveEkfNode
+{
+    public:
+        DriveEkfNode(ros::NodeHandle& n, const DriveEkf::Noise& noise,
+                double frequency, double gyro_var,
+                const std::string& o_frame, const std::string& b_frame) :
+            filter{noise},
+            gyro_variance{gyro_var},
+            odometry_frame{o_frame},
+            base_frame{b_frame}
+        {
+            DriveEkf::Covariance initial = DriveEkf::Covariance::Zero();
+            initial.diagonal() << 1e-4, 1e-4, 1e-4, 1e-2, 1e-2, 1e-2;
+            filter.reset(DriveEkf::State::Zero(), initial);
+
+            publisher = n.advertise<nav_msgs::Odometry>("odometry/filtered", 10);
+            imu_subscriber = n.subscribe("imu", 20, &DriveEkfNode::processImu, this);
+            drivebase_subscriber = n.subscribe("drivebase_odom", 20,
+                    &DriveEkfNode::processVelocity, this);
+            visual_subscriber = n.subscribe("visual_odom", 20,
+                    &DriveEkfNode::processVelocity, this);
+            fiducial_subscriber = n.subscribe("fiducial_odom", 5,
+                    &DriveEkfNode::processFiducial, this);
+            timer = n.createTimer(ros::Duration(1.0 / frequency),
+                    &DriveEkfNode::publish, this);
+        }
+        ~DriveEkfNode() = default;
+        DriveEkfNode(const DriveEkfNode&) = delete;
+        DriveEkfNode& operator=(const DriveEkfNode&) = delete;
+        DriveEkfNode(DriveEkfNode&&) = delete;
+        DriveEkfNode& operator=(DriveEkfNode&&) = delete;
+
+    private:
+        DriveEkf filter;
+        ros::Time filter_time{};
+
+        //recent filter poses, for moving late poses up to now
+        struct Pose2d
+        {
+            double x;
+            double y;
+            double yaw;
+        };
+        StampedBuffer<Pose2d> history{1000};
+        const double gyro_variance;
+        const std::string& odometry_frame;
+        const std::string& base_frame;
+
+        ros::Publisher publisher;
+        ros::Subscriber imu_subscriber;
+        ros::Subscriber drivebase_subscriber;
+        ros::Subscriber visual_subscriber;
+        ros::Subscriber fiducial_subscriber;
+        ros::Timer timer;
+        tf2_ros::TransformBroadcaster broadcaster;
+
+        //past this the robot could have done anything, don't integrate it
+        const double MAX_TIME_DELTA = 0.5;
+        //used when a source reports no variance
+        const double DEFAULT_VARIANCE = 1e-2;
+
+        /*
+         * Predicts the filter up to the stamp, unstamped messages are taken to
+         * be from now.
+         * */
+        void advanceTo(ros::Time stamp)
+        {
+            if (stamp.isZero())
+                stamp = ros::Time::now();
+            if (filter_time.isZero())
+                filter_time = stamp;
+            if (stamp <= filter_time)
+                return;
+            filter.predict(std::min((stamp - filter_time).toSec(), MAX_TIME_DELTA));
+            filter_time = stamp;
+            const auto &s = filter.state();
+            history.push(stamp, Pose2d{s(DriveEkf::X), s(DriveEkf::Y), s(DriveEkf::YAW)});
+        }
+
+        /*
+         * Adds the motion the filter saw between the stamp and now to a pose
+         * measured at the stamp.
+         * */
+        void moveForward(const ros::Time &stamp, double &x, double &y, double &yaw) const
+        {
+            std::size_t index;
+            if (stamp >= filter_time || !history.nearest(stamp, index))
+                return;
+            const auto &then = history.at(index).second;
+            const auto &now = filter.state();
+            double c = std::cos(then.yaw), s = std::sin(then.yaw);
+            double dx = now(DriveEkf::X) - then.x, dy = now(DriveEkf::Y) - then.y;
+            //the motion in the robot frame at the stamp
+            double forward = c * dx + s * dy, left = -s * dx + c * dy;
+            double turned = DriveEkf::normalizeAngle(now(DriveEkf::YAW) - then.yaw);
+            x += std::cos(yaw) * forward - std::sin(yaw) * left;
+            y += std::sin(yaw) * forward + std::cos(yaw) * left;
+            yaw = DriveEkf::normalizeAngle(yaw + turned);
+        }
+
+        static double variance(double reported, double fallback)
+        {
+            return reported > 0 ? reported : fallback;
+        }
+
+        void processImu(const sensor_msgs::ImuConstPtr& imu)
+        {
+            advanceTo(imu->header.stamp);
+            filter.updateGyro(imu->angular_velocity.z,
+                    variance(imu->angular_velocity_covariance[8], gyro_variance));
+        }
+
+        //the treads and the stereo camera both measure v and omega
+        void processVelocity(const nav_msgs::OdometryConstPtr& odom)
+        {
+            advanceTo(odom->header.stamp);
+            const auto &covariance = odom->twist.covariance;
+            filter.updateVelocity(odom->twist.twist.linear.x,
+                    odom->twist.twist.angular.z,
+                    variance(covariance[0], DEFAULT_VARIANCE),
+                    variance(covariance[35], DEFAULT_VARIANCE));
+        }
+
+        void processFiducial(const nav_msgs::OdometryConstPtr& odom)
+        {
+            advanceTo(odom->header.stamp);
+            const auto &c = odom->pose.covariance;
+            Eigen::Matrix3d covariance{};
+            covariance << variance(c[0], DEFAULT_VARIANCE), c[1], c[5],
+                       c[6], variance(c[7], DEFAULT_VARIANCE), c[11],
+                       c[30], c[31], variance(c[35], DEFAULT_VARIANCE);
+            const auto &pose = odom->pose.pose;
+            tf2::Quaternion q{pose.orientation.x, pose.orientation.y,
+                pose.orientation.z, pose.orientation.w};
+            double roll, pitch, yaw;
+            tf2::Matrix3x3(q).getRPY(roll, pitch, yaw);
+            double x = pose.position.x, y = pose.position.y;
+            moveForward(odom->header.stamp, x, y, yaw);
+            filter.updatePose(x, y, yaw, covariance);
+        }
+
+        void publish(const ros::TimerEvent&)
+        {
+            advanceTo(ros::Time::now());
+            const auto &s = filter.state();
+            const auto &p = filter.covariance();
+
+            tf2::Quaternion q{};
+            q.setRPY(0, 0, s(DriveEkf::YAW));
+
+            geometry_msgs::TransformStamped transform{};
+            transform.header.stamp = filter_time;
+            transform.header.frame_id = odometry_frame;
+            transform.child_frame_id = base_frame;
+            transform.transform.translation.x = s(DriveEkf::X);
+            transform.transform.translation.y = s(DriveEkf::Y);
+            transform.transform.rotation.x = q.x();
+            transform.transform.rotation.y = q.y();
+            transform.transform.rotation.z = q.z();
+            transform.transform.rotation.w = q.w();
+            broadcaster.sendTransform(transform);
+
+            nav_msgs::Odometry odom{};
+            odom.header = transform.header;
+            odom.child_frame_id = base_frame;
+            odom.pose.pose.position.x = s(DriveEkf::X);
+            odom.pose.pose.position.y = s(DriveEkf::Y);
+            odom.pose.pose.orientation = transform.transform.rotation;
+            odom.twist.twist.linear.x = s(DriveEkf::V);
+            odom.twist.twist.angular.z = s(DriveEkf::OMEGA);
+
+            //x y z roll pitch yaw, the 2d terms come from the filter
+            const int pose_index[3] = {0, 1, 5};
+            const int state_index[3] = {DriveEkf::X, DriveEkf::Y, DriveEkf::YAW};
+            for (int i = 0; i < 3; ++i)
+                for (int j = 0; j < 3; ++j)
+                    odom.pose.covariance[6 * pose_index[i] + pose_index[j]] =
+                        p(state_index[i], state_index[j]);
+            odom.twist.covariance[0] = p(DriveEkf::V, DriveEkf::V);
+            odom.twist.covariance[5] = p(DriveEkf::V, DriveEkf::OMEGA);
+            odom.twist.covariance[30] = p(DriveEkf::OMEGA, DriveEkf::V);
+            odom.twist.covariance[35] = p(DriveEkf::OMEGA, DriveEkf::OMEGA);
+            publisher.publish(odom);
+        }
+};
+
+int main(int argc, char** argv)
+{
+    ros::init(argc, argv, "drive_ekf");
+    ros::NodeHandle n{};
+
+    std::string odometry_frame, base_frame;
+    double frequency, gyro_variance;
+    DriveEkf::Noise noise{};
+    ros::param::param<std::string>("~odom_frame", odometry_frame, "odom");
+    ros::param::param<std::string>("~base_frame", base_frame, "base_footprint");
+    ros::param::param<double>("~frequency", frequency, 100);
+    ros::param::param<double>("~gyro_variance", gyro_variance, 1e-4);
+    ros::param::param<double>("~position_noise", noise.position, 1e-4);
+    ros::param::param<double>("~yaw_noise", noise.yaw, 1e-4);
+    ros::param::param<double>("~velocity_noise", noise.velocity, 0.5);
+    ros::param::param<double>("~turn_rate_noise", noise.turn_rate, 0.5);
+    ros::param::param<double>("~bias_noise", noise.bias, 1e-6);
+    if (frequency <= 0)
+        frequency = 100;
+
+    DriveEkfNode node{n, noise, frequency, gyro_variance, odometry_frame, base_frame};
+    ros::spin();
+    return 0;
+}
@@ -7,17 +7,20 @@
  * Parameters:
  *   - ~parent_frame: the frame our robot exists in (string, default: "odom")
  *   - ~child_frame: the frame of the robot (string, default: "base_footprint")
- *   - ~wheel_span: the separation of the treads of the robot. (double,
- *   default)
- *   - ~rate: how quickly to publish hz. (double, default 10)
+ *   - /wheel_span: the separation of the tread centers, shared with the
+ *   drivebase control (double, default 0.5588)
+ *   - ~rate: how quickly to publish hz, integration runs on every reading
+ *   independently of this. (double, default 10)
  * Subscribed topics:
- *   - /arduino :(tfr_msgs/ArduinoReading) The most current information coming
- *   in from the sensors.
+ *   - /sensors/arduino_a :(tfr_msgs/ArduinoAReading) left tread velocity
+ *   - /sensors/arduino_b :(tfr_msgs/ArduinoBReading) right tread velocity
  * Published topics: 
  *   - /drivebase_odom : (nav_msgs/Odometry) the location of the
  *   base_footprint tracked by tread motion.
  * Services:
- *  - /set_drivebase_odometry : (tfr_msgs/SetOdometry) resets the basis of
+ *  - /set_drivebase_odometry : (tfr_msgs/SetOdometry) blends a measured
+ *  pose into odometry, weighted by covariance
+ *  - /reset_drivebase_odometry : (tfr_msgs/SetOdometry) resets the basis of
  *  odometry to a new position
  * */
 #include <ros/ros.h>
@@ -34,6 +37,8 @@
 #include <tf2/convert.h>
 #include <tf2/LinearMath/Quaternion.h>
 #include <tf2/LinearMath/Scalar.h>
+#include <tfr_utilities/tread_synchronizer.h>
+#include <tfr_utilities/stamped_buffer.h>
 
 class DrivebaseOdometryPublisher
 {
@@ -47,14 +52,26 @@ class DrivebaseOdometryPublisher
 	DrivebaseOdometryPublisher(ros::NodeHandle &n, 
                 const std::string& p_frame, 
                 const std::string& c_frame,
-                const double& wheel_sep) :
+                const double& wheel_sep,
+                const double& rate) :
             parent_frame{p_frame},
             child_frame{c_frame},
             wheel_span{wheel_sep},
             x{},
             y{},
             angle{},
-            tf_broadcaster{}
+            v_l{},
+            v_r{},
+            v_lin{},
+            v_ang{},
+            var_x{DEFAULT_MEASUREMENT_VARIANCE},
+            var_y{DEFAULT_MEASUREMENT_VARIANCE},
+            var_yaw{DEFAULT_MEASUREMENT_VARIANCE},
+            var_v_lin{TWIST_VARIANCE},
+            var_v_ang{TWIST_VARIANCE},
+            rejections{0},
+            tf_broadcaster{},
+            history{HISTORY_SIZE}
     {
 		//get most current sensor infromation 
         arduino_a = n.subscribe("/sensors/arduino_a", 15, &DrivebaseOdometryPublisher::readArduinoA, this);
@@ -62,6 +79,7 @@ class DrivebaseOdometryPublisher
 		
 		//odometry_publisher: publish to the location of the base_footprint tracked by tread motion.
         odometry_publisher = n.advertise<nav_msgs::Odometry>("/drivebase_odom", 15); 
+        publish_timer = n.createTimer(ros::Duration(1/rate), &DrivebaseOdometryPublisher::publishOdometry, this);
 		
 		///set_drivebase_odometry : resets the basis of odometry to a new position
         set_odometry = n.advertiseService("set_drivebase_odometry", &DrivebaseOdometryPublisher::setOdometry, this);
@@ -79,64 +97,19 @@ class DrivebaseOdometryPublisher
     DrivebaseOdometryPublisher& operator=(DrivebaseOdometryPublisher&) = delete;
 
         /*****************************************************************************************
-        * processOdometry: Main business logic for the node, takes in readings from the arduino,
-        * 		and publishes them across the network.
-		* Preconditions: is subscribed to recieve information from the sensors (tfr_msgs/ArduinoReading)
-		* Postconditions: Readings from the arduino are published across the network
+        * publishOdometry: Publishes the most recently integrated pose across the network, runs
+        * 		on a timer decoupled from the rate the arduinos report at.
+		* Preconditions: at least two tread readings have been integrated
+		* Postconditions: the pose and twist at the last integrated reading are published
         *****************************************************************************************/
-        void processOdometry()
+        void publishOdometry(const ros::TimerEvent&)
         {
-            //Grab the neccessary data
-            tfr_msgs::ArduinoAReading reading_a;
-            tfr_msgs::ArduinoBReading reading_b;
-            if (latest_arduino_a != nullptr)
-                reading_a = *latest_arduino_a;
-
-            if (latest_arduino_b != nullptr)
-                reading_b = *latest_arduino_b;
-
-            //first we process the data
-            auto t_1 = ros::Time::now();
-            double d_t = (t_1 - t_0).toSec();
-			
-            //if this is the first message we skip it to initialize time
-            //properly
-            if (!t_0.isValid())
-            {
-                t_0 = ros::Time::now();
+            if (!t_0.isValid() || t_0.isZero())
                 return;
-            }
-
-            //message gives us velocity in meters/second from each individual
-            //tread
-            double v_l = -reading_a.tread_left_vel;
-            double v_r = reading_b.tread_right_vel;
-
-            //basic differential kinematics to get combined velocities
-            double v_ang = (v_r-v_l)/wheel_span;
-            double v_lin = (v_r+v_l)/2;
-            
-            //break into xy components and increment
-            double d_angle = v_ang * d_t;
-            rotateQuaternionByYaw(angle, d_angle);
-
-            // yaw (z-axis rotation)
-            auto yaw = quaternionToYaw(angle);
-            double v_x = v_lin*cos(yaw);
-            double v_y = v_lin*sin(yaw);
-
-
-            double d_x = v_x * d_t;
-            x += d_x;
-
-            double d_y = v_y * d_t;
-            y += d_y;
-
-            t_0 = t_1;
 
             //let's package up the message
             nav_msgs::Odometry msg;
-            msg.header.stamp = ros::Time::now();
+            msg.header.stamp = t_0;
             msg.header.frame_id = parent_frame;
             msg.child_frame_id = child_frame;
 
@@ -144,25 +117,28 @@ class DrivebaseOdometryPublisher
             msg.pose.pose.position.y = y;
             msg.pose.pose.position.z = 0;
             msg.pose.pose.orientation = angle;
-            msg.pose.covariance = { 1e-1,    0,    0,    0,    0,    0,
-                0, 1e-1,    0,    0,    0,    0,
+            //the tracked uncertainty, z, roll and pitch are not measured
+            msg.pose.covariance = { var_x,    0,    0,    0,    0,    0,
+                0, var_y,    0,    0,    0,    0,
                 0,    0, 1e-1,    0,    0,    0,
                 0,    0,    0, 1e-1,    0,    0,
                 0,    0,    0,    0, 1e-1,    0,
-                0,    0,    0,    0,    0, 1e-1 };
+                0,    0,    0,    0,    0, var_yaw };
 
-            msg.twist.twist.linear.x = v_x;
-            msg.twist.twist.linear.y = v_y;
+            //the twist is in the child frame (REP 105), the treads can only
+            //drive straight ahead or back
+            msg.twist.twist.linear.x = v_lin;
+            msg.twist.twist.linear.y = 0;
             msg.twist.twist.linear.z = 0;
             msg.twist.twist.angular.x = 0;
             msg.twist.twist.angular.y = 0;
             msg.twist.twist.angular.z = v_ang;
-            msg.twist.covariance = { 5e-2,    0,    0,    0,    0,    0,
-                0, 5e-2,    0,    0,    0,    0,
+            msg.twist.covariance = { var_v_lin,    0,    0,    0,    0,    0,
+                0, var_v_lin,    0,    0,    0,    0,
                 0,    0, 5e-2,    0,    0,    0,
                 0,    0,    0, 5e-2,    0,    0,
                 0,    0,    0,    0, 5e-2,    0,
-                0,    0,    0,    0,    0, 5e-2 };
+                0,    0,    0,    0,    0, var_v_ang };
 	//publish the message
             odometry_publisher.publish(msg);
         }
@@ -171,9 +147,8 @@ class DrivebaseOdometryPublisher
     private:
         ros::Subscriber arduino_a; //the encoder data sub
         ros::Subscriber arduino_b; //the encoder data sub
-        tfr_msgs::ArduinoAReadingConstPtr latest_arduino_a;
-        tfr_msgs::ArduinoBReadingConstPtr latest_arduino_b;
         ros::Publisher odometry_publisher; //the pub for our processed data
+        ros::Timer publish_timer; //publishes independently of integration
         ros::ServiceServer set_odometry;
         ros::ServiceServer reset_odometry;
         tf2_ros::TransformBroadcaster tf_broadcaster;
@@ -183,102 +158,282 @@ class DrivebaseOdometryPublisher
         double x; //the x coordinate of the robot (meters)
         double y; //the y coordinate of the robot (meters)
         geometry_msgs::Quaternion angle; 
-        const double MAX_XY_DELTA = 0.25;
-        const double MAX_THETA_DELTA = 0.065;
-        ros::Time t_0;
+        double v_l; //the last left tread velocity (meters/second)
+        double v_r; //the last right tread velocity (meters/second)
+        double v_lin; //the linear velocity over the last increment (meters/second)
+        double v_ang; //the angular velocity over the last increment (radians/second)
+        //how fast the variances grow with tread motion, regolith slips a lot
+        const double XY_VARIANCE_RATE = 0.02; //meters^2 per meter
+        const double YAW_VARIANCE_RATE = 0.05; //radians^2 per radian
+        const double MIN_VARIANCE = 1e-4;
+        //how much slip each m/s^2 of tread acceleration and rad/s of turning adds
+        const double SLIP_ACCELERATION_GAIN = 1.0;
+        const double SLIP_TURN_GAIN = 2.0;
+        //velocity variance at rest, and per (m/s)^2 or (rad/s)^2 of motion
+        const double TWIST_VARIANCE = 1e-3;
+        const double SPEED_VARIANCE = 5e-2;
+        //used for measurements that don't give a covariance
+        const double DEFAULT_MEASUREMENT_VARIANCE = 1e-1;
+        //chi squared, 3 degrees of freedom, 99%
+        const double GATE = 11.34;
+        double var_x; //the variance of x (meters^2)
+        double var_y; //the variance of y (meters^2)
+        double var_yaw; //the variance of yaw (radians^2)
+        double var_v_lin; //the variance of the linear velocity (meters/second)^2
+        double var_v_ang; //the variance of the angular velocity (radians/second)^2
+        //after this many corrections are rejected in a row the treads have
+        //slipped past what the variance allows, and the next one is taken outright
+        const int MAX_REJECTIONS = 3;
+        int rejections; //corrections rejected since the last accepted one
+        //longer gaps than this between readings are not integrated across
+        const double MAX_TIME_DELTA = 0.5;
+        ros::Time t_0; //the stamp of the last integrated reading
+        TreadSynchronizer synchronizer; //lines up the left and right treads
+
+        //a pose on the xy plane and its variance
+        struct PoseRecord
+        {
+            double x;
+            double y;
+            double yaw;
+            double var_x;
+            double var_y;
+            double var_yaw;
+        };
+        //how many integrated poses are remembered for late corrections, a few
+        //seconds at the rate the treads are read
+        static const std::size_t HISTORY_SIZE = 256;
+        StampedBuffer<PoseRecord> history;
 
 	/********************************************************************************************
-	* readArduinoA: Get most current sensor infromation
-	* Preconditions: can subscribe to topic /arduino :(tfr_msgs/ArduinoReading)
-	* Postconditions: latest_arduino_a is updated with arduino from the /sensors/arduino_a topic 
+	* readArduinoA: Integrates the odometry up to the left tread reading
+	* Preconditions: can subscribe to topic /sensors/arduino_a :(tfr_msgs/ArduinoAReading)
+	* Postconditions: the pose is integrated up to the stamp of the reading
 	**********************************************************************************************/
-     void readArduinoA(const tfr_msgs::ArduinoAReadingConstPtr &msg)
-     {
-     	latest_arduino_a = msg;
-     }
+        void readArduinoA(const tfr_msgs::ArduinoAReadingConstPtr &msg)
+        {
+            synchronizer.addLeft(getStamp(msg->header), -msg->tread_left_vel);
+            integrateSynchronized();
+        }
 
 	/********************************************************************************************
-	* readArduinoB: Get most current sensor infromation
-	* Preconditions: can subscribe to topic /arduino :(tfr_msgs/ArduinoReading)
-	* Postconditions: latest_arduino_b is updated with arduino from the /sensors/arduino_b topic
+	* readArduinoB: Integrates the odometry up to the right tread reading
+	* Preconditions: can subscribe to topic /sensors/arduino_b :(tfr_msgs/ArduinoBReading)
+	* Postconditions: the pose is integrated up to the stamp of the reading
 	*********************************************************************************************/
         void readArduinoB(const tfr_msgs::ArduinoBReadingConstPtr &msg)
         {
-            latest_arduino_b = msg;
+            synchronizer.addRight(getStamp(msg->header), msg->tread_right_vel);
+            integrateSynchronized();
+        }
+
+	/********************************************************************************************
+	* integrateSynchronized: Integrates every left/right pair the synchronizer can line up
+	*		The two treads are read by different boards at different rates, so their readings
+	*		are interpolated onto common stamps before the differential drive math runs.
+	* Preconditions: a reading was just added to the synchronizer
+	* Postconditions: the pose is integrated up to the newest stamp both treads cover
+	*********************************************************************************************/
+        void integrateSynchronized()
+        {
+            TreadSynchronizer::Sample sample{};
+            while (synchronizer.next(sample))
+                integrate(sample.stamp, sample.left, sample.right);
+        }
+
+	/********************************************************************************************
+	* getStamp: the time a reading was sampled, falls back to the time of arrival if the
+	*		stamp was left at zero. Readings from firmware built before the header was added
+	*		don't get here at all, their md5sum no longer matches.
+	* Preconditions: none
+	* Postconditions: a valid time is returned
+	*********************************************************************************************/
+        ros::Time getStamp(const std_msgs::Header &header)
+        {
+            return header.stamp.isZero() ? ros::Time::now() : header.stamp;
+        }
+
+	/********************************************************************************************
+	* integrate: Advances the pose from the last reading to a new one
+	*		Tread velocities are taken as changing linearly between readings, and the heading
+	*		at the middle of the increment is used to split the motion into x and y (RK2).
+	* Preconditions: t_1 is the sample time of the new tread velocities
+	* Postconditions: x, y, angle and t_0 describe the robot at t_1
+	*********************************************************************************************/
+        void integrate(const ros::Time &t_1, double v_l_1, double v_r_1)
+        {
+            double d_t = (t_1 - t_0).toSec();
+
+            //the first reading initializes time, and a long gap means a board
+            //dropped out, so there is nothing trustworthy to integrate across
+            if (t_0.isZero() || d_t > MAX_TIME_DELTA)
+            {
+                t_0 = t_1;
+                v_l = v_l_1;
+                v_r = v_r_1;
+                return;
+            }
+
+            //no increment to integrate
+            if (d_t <= 0)
+            {
+                v_l = v_l_1;
+                v_r = v_r_1;
+                return;
+            }
+
+            //basic differential kinematics on the mean tread velocities
+            double v_l_mid = (v_l + v_l_1)/2;
+            double v_r_mid = (v_r + v_r_1)/2;
+            v_ang = (v_r_mid-v_l_mid)/wheel_span;
+            v_lin = (v_r_mid+v_l_mid)/2;
+
+            //break into xy components at the midpoint heading and increment
+            double d_angle = v_ang * d_t;
+            auto yaw = quaternionToYaw(angle) + d_angle/2;
+            x += v_lin*cos(yaw)*d_t;
+            y += v_lin*sin(yaw)*d_t;
+            rotateQuaternionByYaw(angle, d_angle);
+
+            //treads slip most while speeding up, slowing down and skid
+            //steering, so every increment adds to the uncertainty in
+            //proportion to how far it went and how hard it was driven
+            double acceleration = (std::abs(v_l_1 - v_l) + std::abs(v_r_1 - v_r))/d_t;
+            double slip = SLIP_ACCELERATION_GAIN*acceleration + SLIP_TURN_GAIN*std::abs(v_ang);
+            var_x += XY_VARIANCE_RATE*(1 + slip)*std::abs(v_lin*d_t);
+            var_y += XY_VARIANCE_RATE*(1 + slip)*std::abs(v_lin*d_t);
+            var_yaw += YAW_VARIANCE_RATE*(1 + slip)*std::abs(d_angle);
+            var_v_lin = TWIST_VARIANCE + SPEED_VARIANCE*(1 + slip)*v_lin*v_lin;
+            var_v_ang = TWIST_VARIANCE + SPEED_VARIANCE*(1 + slip)*v_ang*v_ang;
+
+            t_0 = t_1;
+            v_l = v_l_1;
+            v_r = v_r_1;
+            history.push(t_0, PoseRecord{x, y, quaternionToYaw(angle), var_x, var_y, var_yaw});
         }
 
        
 	/******************************************************************************************************
-	* setOdometry: Set odometry from fiducial markers, provides smoothing
+	* setOdometry: Set odometry from fiducial markers, weighted by covariance
 	* Preconditions: can advertise to set_drivebase_odometry topic, can provide service to 
 	*				/set_drivebase_odometry : (tfr_msgs/SetOdometry)
-	* Postconditions: angle is updated with its new value, true is returned after the angle has been updated
+	* Postconditions: the pose is blended toward the measurement, response.accepted is false if the
+	*				measurement was too far from the pose to be believed
 	*********************************************************************************************************/
         bool setOdometry(tfr_msgs::SetOdometry::Request& request,
                 tfr_msgs::SetOdometry::Response& response)
         {
-
-            auto dx = request.pose.position.x - x;
-            if (std::abs(dx) >= MAX_XY_DELTA)
-                dx = (dx >= 0) ? MAX_XY_DELTA : -MAX_XY_DELTA;
-            x += dx;
-
-            auto dy = request.pose.position.y - y;
-            if (std::abs(dy) > MAX_XY_DELTA)
-                dy = (dy >= 0) ? MAX_XY_DELTA : -MAX_XY_DELTA;
-            y += dy;
-
-            auto new_q = getTfQuaternion(request.pose.orientation);
-            auto old_q = getTfQuaternion(angle);
-            auto delta = new_q * old_q.inverse();
-            if (std::abs(delta.getZ()) > MAX_THETA_DELTA)
-            {
-                auto sign = ( delta.getZ() * delta.getW() >= 0)? 1 : -1;
-                tf2::Quaternion rotation{0.0, 0.0, 0.065 * sign, 0.998};
-                auto new_value = old_q * rotation;
-                angle = getStdQuaternion(new_value);
-            }
-            else
-                angle = request.pose.orientation;
+            response.accepted = correctOdometry(request, false);
             return true;
         }
 
     /******************************************************************************************************
-	* setOdometry: Set odometry from fiducial markers, provides no smoothing
-	* Preconditions: can advertise to set_drivebase_odometry topic, can provide service to 
-	*				/set_drivebase_odometry : (tfr_msgs/SetOdometry)
-	* Postconditions: outputs message stating that odometry has been reset, angel has been reset based on position,
-	*				true is returned after angle has been updated
+	* resetOdometry: Set odometry from fiducial markers, takes the measurement outright
+	* Preconditions: can advertise to reset_drivebase_odometry topic, can provide service to 
+	*				/reset_drivebase_odometry : (tfr_msgs/SetOdometry)
+	* Postconditions: outputs message stating that odometry has been reset, the pose and its uncertainty
+	*				are those of the measurement, true is returned after the pose has been updated
 	*********************************************************************************************************/
         bool resetOdometry(tfr_msgs::SetOdometry::Request& request,
                 tfr_msgs::SetOdometry::Response& response)
         {
             ROS_INFO("Drivebase Odometry Publisher: resetting drivebase odometry");
-
-            x = request.pose.position.x;
-            y = request.pose.position.y;
-            angle = request.pose.orientation;
+            response.accepted = correctOdometry(request, true);
             return true;
         }
-	
-	/***************************************************************************
-	* tf2::Quaternion getTfQuaternion: create a quaternion based on orientation
-	* Preconditions: can determin orientiation
-	* Postconditions: a quaternion value is returned
-	****************************************************************************/
-        tf2::Quaternion getTfQuaternion(geometry_msgs::Quaternion& q)
+
+	/******************************************************************************************************
+	* correctOdometry: Blends a measured pose into the odometry in one step
+	*		Each of x, y and yaw gets a scalar kalman update, the gain is the odometry variance over the
+	*		variance of the difference. Measurements whose difference is too unlikely for the combined
+	*		variance are rejected, unless resetting, which takes the measurement outright. A run of
+	*		rejections means the odometry is lost rather than the measurements being bad, so once
+	*		MAX_REJECTIONS are rejected in a row the next measurement is taken as a reset.
+	*
+	*		The correction is applied to the pose at the time it was measured (request.header.stamp), and
+	*		the motion since then is carried forward from the corrected pose, so the lag between image
+	*		capture and this call does not turn into error. Unstamped or too old corrections are applied
+	*		to the newest pose.
+	* Preconditions: the request pose is in the parent frame
+	* Postconditions: the pose, its variance and their history are updated, false if rejected
+	*********************************************************************************************************/
+        bool correctOdometry(const tfr_msgs::SetOdometry::Request& request, bool reset)
         {
-            tf2::Quaternion q_0{q.x, q.y, q.z, q.w};
-            return q_0;
-        }
+            //where we were when the correction was measured
+            PoseRecord basis{x, y, quaternionToYaw(angle), var_x, var_y, var_yaw};
+            std::size_t index = history.size();
+            const auto& stamp = request.header.stamp;
+            if (!history.empty())
+            {
+                //unstamped or older than we remember, correct the newest pose
+                if (stamp.isZero() || !history.atOrBefore(stamp, index))
+                    index = history.size() - 1;
+                basis = history.at(index).second;
+            }
 
+            //measurement variances, row major x y z roll pitch yaw
+            double r_x = request.covariance[0],
+                   r_y = request.covariance[7],
+                   r_yaw = request.covariance[35];
+            if (r_x <= 0 || r_y <= 0 || r_yaw <= 0)
+                r_x = r_y = r_yaw = DEFAULT_MEASUREMENT_VARIANCE;
+
+            double i_x = request.pose.position.x - basis.x;
+            double i_y = request.pose.position.y - basis.y;
+            double i_yaw = normalizeAngle(quaternionToYaw(request.pose.orientation) - basis.yaw);
+
+            double s_x = basis.var_x + r_x,
+                   s_y = basis.var_y + r_y,
+                   s_yaw = basis.var_yaw + r_yaw;
+            double distance = i_x*i_x/s_x + i_y*i_y/s_y + i_yaw*i_yaw/s_yaw;
+            if (!reset && distance > GATE)
+            {
+                if (rejections < MAX_REJECTIONS)
+                {
+                    rejections++;
+                    ROS_WARN("Drivebase Odometry Publisher: rejected correction, distance %f", distance);
+                    return false;
+                }
+                ROS_WARN("Drivebase Odometry Publisher: %d corrections rejected in a row, resetting to distance %f",
+                        rejections, distance);
+                reset = true;
+            }
+            rejections = 0;
+
+            double k_x = reset ? 1 : basis.var_x/s_x,
+                   k_y = reset ? 1 : basis.var_y/s_y,
+                   k_yaw = reset ? 1 : basis.var_yaw/s_yaw;
+
+            //how much uncertainty the correction took away at that time
+            PoseRecord reduction{};
+            reduction.var_x = reset ? basis.var_x - r_x : k_x*basis.var_x;
+            reduction.var_y = reset ? basis.var_y - r_y : k_y*basis.var_y;
+            reduction.var_yaw = reset ? basis.var_yaw - r_yaw : k_yaw*basis.var_yaw;
+
+            //the same rigid correction moves every later pose, which is exactly
+            //what re-integrating the tread increments from the corrected pose gives
+            for (auto i = index; i < history.size(); i++)
+                correctPose(history.at(i).second, basis, k_x*i_x, k_y*i_y, k_yaw*i_yaw, reduction);
+            PoseRecord current{x, y, quaternionToYaw(angle), var_x, var_y, var_yaw};
+            correctPose(current, basis, k_x*i_x, k_y*i_y, k_yaw*i_yaw, reduction);
+            x = current.x;
+            y = current.y;
+            angle = yawToQuaternion(current.yaw);
+            var_x = current.var_x;
+            var_y = current.var_y;
+            var_yaw = current.var_yaw;
+            return true;
+        }
+	
 	/*************************************************************************************************
-	* geometry_msgs::Quaternion getStdQuaternion: create a quaternion based on a different quaternion
-	* Preconditions: quaternion parameter is initalized
+	* geometry_msgs::Quaternion yawToQuaternion: create a quaternion from a yaw (z-axis rotation)
+	* Preconditions: none
 	* Postconditions: a quaternion value is returned
 	***************************************************************************************************/
-        geometry_msgs::Quaternion getStdQuaternion(tf2::Quaternion& q_0)
+        geometry_msgs::Quaternion yawToQuaternion(double yaw)
         {
+            tf2::Quaternion q_0{};
+            q_0.setRPY(0, 0, yaw);
             geometry_msgs::Quaternion q;
             q.x = q_0.getX();
             q.y = q_0.getY();
@@ -287,12 +442,42 @@ class DrivebaseOdometryPublisher
             return q;
         }
 
+	/*************************************************************************************************
+	* normalizeAngle: wraps an angle into [-pi, pi]
+	* Preconditions: none
+	* Postconditions: the equivalent angle is returned
+	***************************************************************************************************/
+        double normalizeAngle(double theta)
+        {
+            return atan2(sin(theta), cos(theta));
+        }
+
+	/*************************************************************************************************
+	* correctPose: moves a pose by the correction (dx, dy, d_yaw) made to the basis pose
+	*		The pose keeps its position and heading relative to the basis, and the variance it gained
+	*		since the basis, so its variance drops by the same amount the basis did.
+	* Preconditions: the pose is no older than the basis
+	* Postconditions: the pose is updated
+	***************************************************************************************************/
+        void correctPose(PoseRecord& pose, const PoseRecord& basis,
+                double dx, double dy, double d_yaw, const PoseRecord& reduction)
+        {
+            double rel_x = pose.x - basis.x;
+            double rel_y = pose.y - basis.y;
+            pose.x = basis.x + dx + cos(d_yaw)*rel_x - sin(d_yaw)*rel_y;
+            pose.y = basis.y + dy + sin(d_yaw)*rel_x + cos(d_yaw)*rel_y;
+            pose.yaw = normalizeAngle(pose.yaw + d_yaw);
+            pose.var_x = std::max(pose.var_x - reduction.var_x, MIN_VARIANCE);
+            pose.var_y = std::max(pose.var_y - reduction.var_y, MIN_VARIANCE);
+            pose.var_yaw = std::max(pose.var_yaw - reduction.var_yaw, MIN_VARIANCE);
+        }
+
         /*************************************************************************
          * quaternionToYaw: converts a quaterion value to a yaw (z-axis rotation)
 		 * Preconditions: quaternion parameter is initalized
 		 * Postconditions: yaw value is returned
          *************************************************************************/
-        double quaternionToYaw(geometry_msgs::Quaternion& q)
+        double quaternionToYaw(const geometry_msgs::Quaternion& q)
         {
             // yaw (z-axis rotation)
             double siny = +2.0 * (q.w * q.z + q.x * q.y);
@@ -330,16 +515,10 @@ int main(int argc, char **argv)
 			  //r is the rate: how quickly to publish hz.
     ros::param::param<std::string>("~parent_frame", parent_frame, "odom");
     ros::param::param<std::string>("~child_frame", child_frame, "base_footprint");
-    ros::param::param<double>("~wheel_span", wheel_span, 0.645);
+    ros::param::param<double>("/wheel_span", wheel_span, 0.5588);
     ros::param::param<double>("~rate", r, 10.0);
-    DrivebaseOdometryPublisher publisher{n, parent_frame, child_frame, wheel_span};
-    ros::Rate rate(r);
-    while(ros::ok())
-    {
-        publisher.processOdometry(); //arduino readings are published across the network
-        ros::spinOnce();
-        rate.sleep();
-
-    }
+    DrivebaseOdometryPublisher publisher{n, parent_frame, child_frame, wheel_span, r};
+    //readings are integrated as they arrive, publishing runs on a timer
+    ros::spin();
     return 0;
 }
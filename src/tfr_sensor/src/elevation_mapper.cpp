@@ -0,0 +1,222 @@
+#include "elevation_mapper.h"
+#include <tf2_geometry_msgs/tf2_geometry_msgs.h>
+#include <boost/make_shared.hpp>
+#include <opencv2/core/utility.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+ElevationMapper::ElevationMapper(ros::NodeHandle& n, const Parameters& p) :
+    parameters(p),
+    tf_buffer{},
+    tf_listener{tf_buffer},
+    heights(p.size * p.size, 0),
+    observations(p.size * p.size, 0),
+    origin_x{-p.size / 2},
+    origin_y{-p.size / 2},
+    accumulators(std::max(p.threads, 1)),
+    shifted_heights(p.size * p.size, 0),
+    shifted_observations(p.size * p.size, 0)
+{
+    for (auto &accumulator : accumulators)
+    {
+        accumulator.sum.assign(heights.size(), 0);
+        accumulator.count.assign(heights.size(), 0);
+    }
+    publisher = n.advertise<nav_msgs::OccupancyGrid>("traversability", 5);
+    subscriber = n.subscribe("points", 2, &ElevationMapper::update, this);
+}
+
+void ElevationMapper::update(const sensor_msgs::PointCloud2ConstPtr& cloud)
+{
+    int offsets[3] = {-1, -1, -1};
+    const char *names[3] = {"x", "y", "z"};
+    for (const auto &field : cloud->fields)
+        for (int i = 0; i < 3; ++i)
+            if (field.name == names[i] &&
+                    field.datatype == sensor_msgs::PointField::FLOAT32)
+                offsets[i] = field.offset;
+    if (offsets[0] < 0 || offsets[1] < 0 || offsets[2] < 0 || cloud->is_bigendian)
+    {
+        ROS_WARN_THROTTLE(5, "ElevationMapper: cloud has no float xyz fields");
+        return;
+    }
+
+    tf2::Transform transform{}, base{};
+    try
+    {
+        auto stamped = tf_buffer.lookupTransform(parameters.map_frame,
+                cloud->header.frame_id, cloud->header.stamp, ros::Duration(0.1));
+        tf2::fromMsg(stamped.transform, transform);
+        stamped = tf_buffer.lookupTransform(parameters.map_frame,
+                parameters.base_frame, cloud->header.stamp, ros::Duration(0.1));
+        tf2::fromMsg(stamped.transform, base);
+    }
+    catch (tf2::TransformException &ex)
+    {
+        ROS_WARN_THROTTLE(5, "ElevationMapper: %s", ex.what());
+        return;
+    }
+    const tf2::Vector3 robot = base.getOrigin();
+    recenter(robot);
+
+    //the slices run on opencv's thread pool, no threads are spawned per cloud
+    int slices = std::min<int>(accumulators.size(), std::max<uint32_t>(cloud->height, 1));
+    cv::parallel_for_(cv::Range(0, slices), [&](const cv::Range &range)
+            {
+                for (int i = range.start; i < range.end; ++i)
+                {
+                    uint32_t begin = cloud->height * i / slices;
+                    uint32_t end = cloud->height * (i + 1) / slices;
+                    accumulate(*cloud, offsets, transform, robot, begin, end, accumulators[i]);
+                }
+            }, slices);
+
+    //blend this cloud into the map, and clear the accumulators for the next
+    const float max_observations = parameters.max_observations;
+    for (std::size_t cell = 0; cell < heights.size(); ++cell)
+    {
+        float sum = 0;
+        uint32_t count = 0;
+        for (int i = 0; i < slices; ++i)
+        {
+            sum += accumulators[i].sum[cell];
+            count += accumulators[i].count[cell];
+            accumulators[i].sum[cell] = 0;
+            accumulators[i].count[cell] = 0;
+        }
+        if (count == 0)
+            continue;
+        float mean = sum / count;
+        if (observations[cell] == 0)
+            heights[cell] = mean;
+        else
+            heights[cell] += (mean - heights[cell]) /
+                (std::min<float>(observations[cell], max_observations) + 1);
+        if (observations[cell] < parameters.max_observations)
+            ++observations[cell];
+    }
+
+    publish(cloud->header.stamp, robot);
+}
+
+void ElevationMapper::accumulate(const sensor_msgs::PointCloud2& cloud,
+        const int offsets[3], const tf2::Transform& transform,
+        const tf2::Vector3& robot, uint32_t begin, uint32_t end,
+        Accumulator& accumulator) const
+{
+    const uint32_t step = parameters.step;
+    const double max_range2 = parameters.max_range * parameters.max_range;
+    for (uint32_t row = begin; row < end; row += step)
+    {
+        const uint8_t *point = cloud.data.data() + row * cloud.row_step;
+        for (uint32_t column = 0; column < cloud.width;
+                column += step, point += step * cloud.point_step)
+        {
+            float xyz[3];
+            for (int i = 0; i < 3; ++i)
+                std::memcpy(&xyz[i], point + offsets[i], sizeof(float));
+            if (!std::isfinite(xyz[0]) || !std::isfinite(xyz[1]) || !std::isfinite(xyz[2]))
+                continue;
+
+            auto p = transform(tf2::Vector3{xyz[0], xyz[1], xyz[2]});
+            double dx = p.x() - robot.x(), dy = p.y() - robot.y();
+            if (dx * dx + dy * dy > max_range2 ||
+                    p.z() - robot.z() > parameters.max_height)
+                continue;
+            int cell = cellIndex(p.x(), p.y());
+            if (cell < 0)
+                continue;
+            accumulator.sum[cell] += p.z();
+            if (accumulator.count[cell] < UINT16_MAX)
+                ++accumulator.count[cell];
+        }
+    }
+}
+
+void ElevationMapper::recenter(const tf2::Vector3& robot)
+{
+    const int size = parameters.size;
+    int target_x = static_cast<int>(std::floor(robot.x() / parameters.resolution)) - size / 2;
+    int target_y = static_cast<int>(std::floor(robot.y() / parameters.resolution)) - size / 2;
+    if (std::abs(target_x - origin_x) < size / 4 && std::abs(target_y - origin_y) < size / 4)
+        return;
+
+    std::fill(shifted_observations.begin(), shifted_observations.end(), 0);
+    int shift_x = target_x - origin_x, shift_y = target_y - origin_y;
+    for (int j = 0; j < size; ++j)
+    {
+        int old_j = j + shift_y;
+        if (old_j < 0 || old_j >= size)
+            continue;
+        for (int i = 0; i < size; ++i)
+        {
+            int old_i = i + shift_x;
+            if (old_i < 0 || old_i >= size)
+                continue;
+            shifted_heights[j * size + i] = heights[old_j * size + old_i];
+            shifted_observations[j * size + i] = observations[old_j * size + old_i];
+        }
+    }
+    heights.swap(shifted_heights);
+    observations.swap(shifted_observations);
+    origin_x = target_x;
+    origin_y = target_y;
+}
+
+/*
+ * Cost is the steepest step to a known neighbor, scaled so max_step is 100.
+ * Cells nobody has seen are unknown.
+ * */
+void ElevationMapper::publish(const ros::Time& stamp, const tf2::Vector3& robot)
+{
+    const int size = parameters.size;
+    auto grid = boost::make_shared<nav_msgs::OccupancyGrid>();
+    grid->header.stamp = stamp;
+    grid->header.frame_id = parameters.map_frame;
+    grid->info.map_load_time = stamp;
+    grid->info.resolution = parameters.resolution;
+    grid->info.width = size;
+    grid->info.height = size;
+    grid->info.origin.position.x = origin_x * parameters.resolution;
+    grid->info.origin.position.y = origin_y * parameters.resolution;
+    grid->info.origin.orientation.w = 1;
+    grid->data.assign(size * size, -1);
+
+    for (int j = 0; j < size; ++j)
+        for (int i = 0; i < size; ++i)
+        {
+            int cell = j * size + i;
+            if (observations[cell] == 0)
+                continue;
+            if (robot.z() - heights[cell] > parameters.max_depth)
+            {
+                grid->data[cell] = 100;
+                continue;
+            }
+            float step = 0;
+            for (int dj = -1; dj <= 1; ++dj)
+                for (int di = -1; di <= 1; ++di)
+                {
+                    int ni = i + di, nj = j + dj;
+                    if (ni < 0 || nj < 0 || ni >= size || nj >= size)
+                        continue;
+                    int neighbor = nj * size + ni;
+                    if (observations[neighbor] == 0)
+                        continue;
+                    step = std::max(step, std::abs(heights[cell] - heights[neighbor]));
+                }
+            grid->data[cell] = static_cast<int8_t>(
+                    100 * std::min<double>(step / parameters.max_step, 1.0));
+        }
+    publisher.publish(grid);
+}
+
+int ElevationMapper::cellIndex(double x, double y) const
+{
+    int i = static_cast<int>(std::floor(x / parameters.resolution)) - origin_x;
+    int j = static_cast<int>(std::floor(y / parameters.resolution)) - origin_y;
+    if (i < 0 || j < 0 || i >= parameters.size || j >= parameters.size)
+        return -1;
+    return j * parameters.size + i;
+}
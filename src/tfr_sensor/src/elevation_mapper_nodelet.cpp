@@ -0,0 +1,69 @@
+/**
+ * Nodelet for the ElevationMapper, see
+ * tfr_sensor/include/tfr_sensor/elevation_mapper.h. Load it into the depth
+ * driver's manager so the full clouds are never serialized.
+ *
+ * Parameters:
+ * ~map_frame: (string, default: "odom")
+ * ~base_frame: (string, default: "base_footprint")
+ * ~resolution: side of a cell [m] (double, default: 0.1)
+ * ~size: cells per side of the map (int, default: 100)
+ * ~max_range: furthest point used [m] (double, default: 3.0)
+ * ~max_height: highest point used above the robot [m] (double, default: 0.5)
+ * ~max_step: untraversable step between cells [m] (double, default: 0.08)
+ * ~max_depth: depth below the robot that is a crater [m] (double, default: 0.15)
+ * ~max_observations: clouds a cell's height averages over (int, default: 10)
+ * ~step: pixel step in each direction (int, default: 2)
+ * ~threads: slices processed in parallel (int, default: 4)
+ * */
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+#include <algorithm>
+#include <memory>
+#include "elevation_mapper.h"
+
+namespace tfr_sensor
+{
+    class ElevationMapperNodelet : public nodelet::Nodelet
+    {
+        public:
+            ElevationMapperNodelet() = default;
+            ~ElevationMapperNodelet() = default;
+            ElevationMapperNodelet(const ElevationMapperNodelet&) = delete;
+            ElevationMapperNodelet& operator=(const ElevationMapperNodelet&) = delete;
+            ElevationMapperNodelet(ElevationMapperNodelet&&) = delete;
+            ElevationMapperNodelet& operator=(ElevationMapperNodelet&&) = delete;
+
+        private:
+            void onInit() override
+            {
+                auto &pn = getPrivateNodeHandle();
+                ElevationMapper::Parameters parameters{};
+                pn.param<std::string>("map_frame", parameters.map_frame, "odom");
+                pn.param<std::string>("base_frame", parameters.base_frame, "base_footprint");
+                pn.param<double>("resolution", parameters.resolution, 0.1);
+                pn.param<int>("size", parameters.size, 100);
+                pn.param<double>("max_range", parameters.max_range, 3.0);
+                pn.param<double>("max_height", parameters.max_height, 0.5);
+                pn.param<double>("max_step", parameters.max_step, 0.08);
+                pn.param<double>("max_depth", parameters.max_depth, 0.15);
+                pn.param<int>("max_observations", parameters.max_observations, 10);
+                pn.param<int>("step", parameters.step, 2);
+                pn.param<int>("threads", parameters.threads, 4);
+                parameters.size = std::max(parameters.size, 4);
+                parameters.step = std::max(parameters.step, 1);
+                parameters.max_observations = std::min(std::max(parameters.max_observations, 1), 255);
+                if (parameters.resolution <= 0 || parameters.max_step <= 0)
+                {
+                    NODELET_WARN("ElevationMapper: resolution and max_step have to be positive");
+                    parameters.resolution = 0.1;
+                    parameters.max_step = 0.08;
+                }
+                mapper.reset(new ElevationMapper{getNodeHandle(), parameters});
+            }
+
+            std::unique_ptr<ElevationMapper> mapper;
+    };
+}
+
+PLUGINLIB_EXPORT_CLASS(tfr_sensor::ElevationMapperNodelet, nodelet::Nodelet)
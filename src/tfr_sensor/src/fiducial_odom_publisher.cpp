@@ -8,9 +8,25 @@
  *   ~bin_frame: The reference frame of the bin (string, default="bin_footprint")
  *   ~odom_frame: The reference frame of odom  (string, default="odom")
  *   ~debug: print debugging info (bool, default: false)
- *   ~rate: how fast to process images
+ *   ~rate: how fast to process images while driving (double, default: 5)
+ *   ~burst_rate: how fast to process images while turning or unsure of the
+ *   pose (double, default: 10)
+ *   ~still_speed, ~still_turn_rate: slower is standing still, when images are
+ *   only processed once after stopping (double, default: 0.02, 0.02)
+ *   ~burst_turn_rate: faster turns use the burst rate (double, default: 0.2)
+ *   ~max_variance, ~max_yaw_variance: filtered pose variances above these use
+ *   the burst rate (double, default: 0.05, 0.02)
+ *   ~lost_timeout: seconds without seeing the board before giving up
+ *   (double, default: 10)
+ *   ~resume_distance, ~resume_angle: how far to drive or turn before looking
+ *   again after giving up (double, default: 0.5, 0.5)
+ * action clients:
+ *   /sensors/rear_cam/aruco, /sensors/front_cam/aruco - the detectors in the
+ *   camera managers, they detect in their camera's latest frame so the
+ *   frames are never copied into this node; both run at the same time
  * subscribed topics:
- *   image (sensor_msgs/Image) - the camera topic
+ *   odometry/filtered (nav_msgs/Odometry) - decides how often to look, see
+ *   tfr_utilities/include/tfr_utilities/fiducial_scheduler.h
  * published topics:
  *   fiducial_odom (geometry_msgs/Odometry)- the odometry topic 
  * */
@@ -19,11 +35,10 @@
 #include <nav_msgs/Odometry.h>
 #include <geometry_msgs/PoseStamped.h>
 #include <tfr_msgs/ArucoAction.h>
-#include <tfr_msgs/WrappedImage.h>
 #include <tfr_msgs/SetOdometry.h>
 #include <tfr_utilities/tf_manipulator.h>
+#include <tfr_utilities/fiducial_scheduler.h>
 #include <actionlib/client/simple_action_client.h>
-#include <robot_localization/SetPose.h>
 #include <tf2/convert.h>
 #include <std_srvs/Empty.h>
 #include <tf2/LinearMath/Quaternion.h>
@@ -32,37 +47,47 @@
 #include <tf2_geometry_msgs/tf2_geometry_msgs.h>
 #include <tf2_ros/transform_broadcaster.h>
 #include <tf2_ros/transform_listener.h>
+#include <algorithm>
+#include <array>
+#include <vector>
+#include <cmath>
 
 class FiducialOdom
 {
     public:
+        using Client = actionlib::SimpleActionClient<tfr_msgs::ArucoAction>;
+
+        //a board sighting expressed as the robot pose in odom
+        struct Estimate
+        {
+            geometry_msgs::Pose pose;
+            boost::array<double, 36> covariance;
+            ros::Time stamp;
+        };
+
         FiducialOdom(ros::NodeHandle& n, 
                 const std::string& f_frame, 
                 const std::string& b_frame,
-                const std::string& o_frame) :
-            aruco{"aruco_action_server", true},
+                const std::string& o_frame,
+                const FiducialScheduler::Parameters& schedule) :
+            rear_aruco{"/sensors/rear_cam/aruco", true},
+            front_aruco{"/sensors/front_cam/aruco", true},
             tf_manipulator{},
             footprint_frame{f_frame},
             bin_frame{b_frame},
             odometry_frame{o_frame},
-            reset_service{n.advertiseService("/reset_fusion", &FiducialOdom::resetFusion, this)}
+            reset_service{n.advertiseService("/reset_fusion", &FiducialOdom::resetFusion, this)},
+            scheduler{schedule}
         {
-            rear_cam_client = n.serviceClient<tfr_msgs::WrappedImage>("/on_demand/rear_cam/image_raw");
-            front_cam_client = n.serviceClient<tfr_msgs::WrappedImage>("/on_demand/front_cam/image_raw");
             publisher = n.advertise<nav_msgs::Odometry>("fiducial_odom", 10 );
-            ROS_INFO("Fiducial Odom Publisher Connecting to Server");
-            aruco.waitForServer();
-            ROS_INFO("Fiducial Odom Publisher Connected to Server");
+            ROS_INFO("Fiducial Odom Publisher Connecting to Servers");
+            rear_aruco.waitForServer();
+            front_aruco.waitForServer();
+            ROS_INFO("Fiducial Odom Publisher Connected to Servers");
             //fill transform buffer
             ros::Duration(2).sleep();
-            //connect to the image clients
-            tfr_msgs::WrappedImage request{};
-            ros::Duration busy_wait{0.1};
-            while(!rear_cam_client.call(request))
-                busy_wait.sleep();
-            while(!front_cam_client.call(request))
-                busy_wait.sleep();
-            ROS_INFO("Fiducial Od)om Publisher: Connected Image Clients");
+            odometry_subscriber = n.subscribe("odometry/filtered", 5,
+                    &FiducialOdom::processMotion, this);
         }
 
         ~FiducialOdom() = default;
@@ -75,118 +100,251 @@ class FiducialOdom
                 std_srvs::Empty::Response& response)
         {
             ROS_INFO("RESETTING SENSORS");
-            processOdometry(true);
+            scheduler.wake();
+            scheduler.report(ros::Time::now(), processOdometry(true));
             return true;
         }
 
-        void processOdometry(bool reset)
+        /*
+         * Looks for the board if the scheduler says it's worth it.
+         * */
+        void update()
+        {
+            ros::Time now = ros::Time::now();
+            if (scheduler.due(now))
+                scheduler.report(now, processOdometry(false));
+        }
+
+        /*
+         * Both cameras run their own detector on their latest frame at the
+         * same time, so a cycle costs one detection instead of two. When both
+         * see the board the sightings are blended by their covariance.
+         * Gives whether the board was seen.
+         * */
+        bool processOdometry(bool reset)
         {
-            tfr_msgs::ArucoResultConstPtr result = nullptr;
-            tfr_msgs::WrappedImage image_wrapper{};
+            //detect in both at once
+            sendAruco(rear_aruco);
+            sendAruco(front_aruco);
 
-            //grab an image
-            if (rear_cam_client.call(image_wrapper))
-                result = sendAruco(image_wrapper);
+            std::vector<Estimate> estimates{};
+            Estimate estimate{};
+            if (getEstimate(rear_aruco, estimate))
+                estimates.push_back(estimate);
+            if (getEstimate(front_aruco, estimate))
+                estimates.push_back(estimate);
 
-            if ((result == nullptr || result->number_found == 0) && front_cam_client.call(image_wrapper))
-                result = sendAruco(image_wrapper);
+            if (estimates.empty())
+                return false;
+            if (estimates.size() == 2)
+                estimate = fuseEstimates(estimates[0], estimates[1]);
+            else
+                estimate = estimates[0];
 
-            if (result != nullptr && result->number_found !=0)
-            {
-                geometry_msgs::PoseStamped unprocessed_pose = result->relative_pose;
-
-                //transform from camera to footprint perspective
-                geometry_msgs::PoseStamped processed_pose;
-                if (!tf_manipulator.transform_pose(unprocessed_pose,
-                            processed_pose, footprint_frame))
-                    return;
-
-                processed_pose.pose.position.z = 0;
-
-                //we need to express that in terms of odom
-                geometry_msgs::Transform relative_bin_transform{};
-
-                //get bin_odom transform
-                if (!tf_manipulator.get_transform(relative_bin_transform,
-                            bin_frame, odometry_frame))
-                    return;
-
-                //footprint_odom transform
-                tf2::Transform p_0{};
-                tf2::convert(processed_pose.pose, p_0);
-                tf2::Transform p_1{};
-                tf2::convert(relative_bin_transform, p_1);
-
-                geometry_msgs::Transform relative_transform{};
-
-                //take the  difference between bin->odom and bin->robot
-                auto difference = p_1.inverseTimes(p_0.inverse());
-                relative_transform = tf2::toMsg(difference);
-
-                //process the odometry
-                geometry_msgs::Pose relative_pose{};
-                relative_pose.position.x = relative_transform.translation.x;
-                relative_pose.position.y = relative_transform.translation.y;
-                relative_pose.position.z = 0;
-                relative_pose.orientation = relative_transform.rotation;
-
-                // handle odometry data
-                nav_msgs::Odometry odom;
-                odom.header.frame_id = odometry_frame;
-                odom.header.stamp = ros::Time::now();
-                odom.child_frame_id = footprint_frame;
-
-                //get our pose and fudge some covariances
-                odom.pose.pose = relative_pose;
-                odom.pose.covariance = {  1e-1,   0,   0,   0,   0,   0,
-                    0,1e-1,   0,   0,   0,   0,
-                    0,   0,1e-1,   0,   0,   0,
-                    0,   0,   0,1e-1,   0,   0,
-                    0,   0,   0,   0,1e-1,   0,
-                    0,   0,   0,   0,   0,1e-1};
-                //fire it off! and cleanup
-                publisher.publish(odom);
-
-                //control error propagation in the drivebase odometry publisher
-                tfr_msgs::SetOdometry odom_req{};
-                odom_req.request.pose = odom.pose.pose;
-                if (!reset)
-                {
-                    ros::service::call("/set_drivebase_odometry", odom_req);
-                }
-                else
-                {
-                    for (double i = 1; i < 100; i += 1)
-                    {
-                        ros::service::call("/set_drivebase_odometry", odom_req);
-                    }
-                }
-
-            }
+            // handle odometry data
+            nav_msgs::Odometry odom;
+            odom.header.frame_id = odometry_frame;
+            //when the images were taken, so fusion lines it up with the imu
+            //and treads
+            odom.header.stamp = estimate.stamp;
+            odom.child_frame_id = footprint_frame;
+
+            //get our pose and how much to trust it
+            odom.pose.pose = estimate.pose;
+            odom.pose.covariance = estimate.covariance;
+            //fire it off! and cleanup
+            publisher.publish(odom);
+
+            //control error propagation in the drivebase odometry publisher
+            //stamped when the image was taken, so the correction lands
+            //where the robot was, not where it is now
+            tfr_msgs::SetOdometry odom_req{};
+            odom_req.request.header.stamp = estimate.stamp;
+            odom_req.request.pose = odom.pose.pose;
+            odom_req.request.covariance = odom.pose.covariance;
+            //a reset takes the pose outright, otherwise it is blended in
+            //by covariance
+            if (!reset)
+                ros::service::call("/set_drivebase_odometry", odom_req);
+            else
+                ros::service::call("/reset_drivebase_odometry", odom_req);
+            return true;
         }
 
     private:
         ros::Publisher publisher;
-        ros::ServiceClient rear_cam_client;
-        ros::ServiceClient front_cam_client;
         ros::ServiceServer reset_service;
-        actionlib::SimpleActionClient<tfr_msgs::ArucoAction> aruco;
+        ros::Subscriber odometry_subscriber;
+        Client rear_aruco;
+        Client front_aruco;
         tf2_ros::TransformBroadcaster broadcaster;
         TfManipulator tf_manipulator;
+        FiducialScheduler scheduler;
 
         const std::string& footprint_frame;
         const std::string& bin_frame;
         const std::string& odometry_frame;
 
-        tfr_msgs::ArucoResultConstPtr sendAruco(const tfr_msgs::WrappedImage& msg)
+        void processMotion(const nav_msgs::OdometryConstPtr& odom)
         {
+            const auto &pose = odom->pose;
+            tf2::Quaternion orientation{};
+            tf2::convert(pose.pose.orientation, orientation);
+            double roll, pitch, yaw;
+            tf2::Matrix3x3(orientation).getRPY(roll, pitch, yaw);
+            FiducialScheduler::Motion motion{pose.pose.position.x,
+                pose.pose.position.y, yaw, odom->twist.twist.linear.x,
+                odom->twist.twist.angular.z,
+                std::max(pose.covariance[0], pose.covariance[7]),
+                pose.covariance[35]};
+            scheduler.updateMotion(odom->header.stamp, motion);
+        }
+
+        /*
+         * Models the uncertainty of a board sighting. Position error grows with
+         * the square of the distance to the board and heading error linearly,
+         * both scale with the reprojection error, shrink with the number of
+         * markers seen, and grow as the board is seen more edge on.
+         * */
+        void estimateCovariance(const tfr_msgs::ArucoResult& result,
+                boost::array<double, 36>& covariance)
+        {
+            //these come from the old hand tuned 1e-1 at about 2 meters
+            const double REFERENCE_DISTANCE = 2.0; //meters
+            const double REFERENCE_PIXEL_ERROR = 0.5; //pixels
+            const double XY_DEVIATION = 0.3; //meters at the reference
+            const double YAW_DEVIATION = 0.3; //radians at the reference
+            const double MAX_VIEWING_ANGLE = 1.4; //radians, keeps cos > 0
+            const double MIN_VARIANCE = 1e-4;
+            const double MAX_VARIANCE = 1e2;
+
+            const auto& position = result.relative_pose.pose.position;
+            double distance = std::hypot(position.x, position.y) / REFERENCE_DISTANCE;
+            double pixels = std::max(result.reprojection_error,
+                    REFERENCE_PIXEL_ERROR) / REFERENCE_PIXEL_ERROR;
+            double markers = std::sqrt(std::max(result.number_found, 1));
+            double obliqueness = 1 / std::cos(std::min(result.viewing_angle, MAX_VIEWING_ANGLE));
+
+            double xy = XY_DEVIATION * distance * distance * pixels * obliqueness / markers;
+            double yaw = YAW_DEVIATION * distance * pixels * obliqueness / markers;
+            double var_xy = std::min(std::max(xy * xy, MIN_VARIANCE), MAX_VARIANCE);
+            double var_yaw = std::min(std::max(yaw * yaw, MIN_VARIANCE), MAX_VARIANCE);
+
+            //z, roll and pitch are not measured
+            covariance = { var_xy,    0,    0,    0,    0,    0,
+                0, var_xy,    0,    0,    0,    0,
+                0,    0, MAX_VARIANCE,    0,    0,    0,
+                0,    0,    0, MAX_VARIANCE,    0,    0,
+                0,    0,    0,    0, MAX_VARIANCE,    0,
+                0,    0,    0,    0,    0, var_yaw };
+        }
+
+        void sendAruco(Client& client)
+        {
+            //no image, the detector takes its camera's latest frame
             tfr_msgs::ArucoGoal goal;
-            goal.image = msg.response.image;
-            goal.camera_info = msg.response.camera_info;
-            //send it to the server
-            aruco.sendGoal(goal);
-            aruco.waitForResult();
-            return aruco.getResult();
+            goal.mode = tfr_msgs::ArucoGoal::LATEST;
+            //send it to the server, the result is collected later
+            client.sendGoal(goal);
+        }
+
+        /*
+         * Waits on a detection and turns it into the robot pose in odom,
+         * false if the board wasn't seen or the transforms aren't available.
+         * */
+        bool getEstimate(Client& client, Estimate& estimate)
+        {
+            client.waitForResult();
+            //aborted when the camera has no frame yet
+            if (client.getState() != actionlib::SimpleClientGoalState::SUCCEEDED)
+                return false;
+            auto result = client.getResult();
+            if (result == nullptr || result->number_found == 0)
+                return false;
+
+            //everything is carried at the capture time, the robot may have
+            //turned a good bit since
+            const ros::Time &stamp = result->image_stamp;
+            geometry_msgs::PoseStamped unprocessed_pose = result->relative_pose;
+            unprocessed_pose.header.stamp = stamp;
+
+            //transform from camera to footprint perspective
+            geometry_msgs::PoseStamped processed_pose;
+            if (!tf_manipulator.transform_pose(unprocessed_pose,
+                        processed_pose, footprint_frame))
+                return false;
+
+            processed_pose.pose.position.z = 0;
+
+            //we need to express that in terms of odom
+            geometry_msgs::Transform relative_bin_transform{};
+
+            //get bin_odom transform
+            if (!tf_manipulator.get_transform(relative_bin_transform,
+                        bin_frame, odometry_frame, stamp, ros::Duration(0.1)))
+                return false;
+
+            //footprint_odom transform
+            tf2::Transform p_0{};
+            tf2::convert(processed_pose.pose, p_0);
+            tf2::Transform p_1{};
+            tf2::convert(relative_bin_transform, p_1);
+
+            //take the  difference between bin->odom and bin->robot
+            auto difference = p_1.inverseTimes(p_0.inverse());
+            geometry_msgs::Transform relative_transform = tf2::toMsg(difference);
+
+            //process the odometry
+            estimate.pose.position.x = relative_transform.translation.x;
+            estimate.pose.position.y = relative_transform.translation.y;
+            estimate.pose.position.z = 0;
+            estimate.pose.orientation = relative_transform.rotation;
+            estimateCovariance(*result, estimate.covariance);
+            estimate.stamp = stamp;
+            return true;
+        }
+
+        /*
+         * Inverse variance weighted blend of two sightings of the board,
+         * x, y and yaw are blended independently. The images are grabbed at
+         * the same time so the newer stamp stands for both.
+         * */
+        Estimate fuseEstimates(const Estimate& a, const Estimate& b)
+        {
+            auto blend = [](double value_a, double var_a, double value_b, double var_b)
+            {
+                return value_a + var_a / (var_a + var_b) * (value_b - value_a);
+            };
+            auto yaw = [](const geometry_msgs::Quaternion& q)
+            {
+                tf2::Quaternion quaternion{};
+                tf2::convert(q, quaternion);
+                double roll, pitch, yaw;
+                tf2::Matrix3x3(quaternion).getRPY(roll, pitch, yaw);
+                return yaw;
+            };
+
+            Estimate fused = a;
+            const std::array<int, 3> axes{{0, 7, 35}};
+            fused.pose.position.x = blend(a.pose.position.x, a.covariance[0],
+                    b.pose.position.x, b.covariance[0]);
+            fused.pose.position.y = blend(a.pose.position.y, a.covariance[7],
+                    b.pose.position.y, b.covariance[7]);
+
+            //blend the yaw difference, so it doesn't matter where pi falls
+            double yaw_a = yaw(a.pose.orientation);
+            double yaw_b = yaw(b.pose.orientation);
+            double difference = std::atan2(std::sin(yaw_b - yaw_a), std::cos(yaw_b - yaw_a));
+            double fused_yaw = blend(0, a.covariance[35], difference, b.covariance[35]) + yaw_a;
+            tf2::Quaternion orientation{};
+            orientation.setRPY(0, 0, fused_yaw);
+            fused.pose.orientation = tf2::toMsg(orientation);
+
+            for (auto axis : axes)
+                fused.covariance[axis] = a.covariance[axis] * b.covariance[axis] /
+                    (a.covariance[axis] + b.covariance[axis]);
+            fused.stamp = std::max(a.stamp, b.stamp);
+            return fused;
         }
 
 };
@@ -197,20 +355,36 @@ int main(int argc, char** argv)
     ros::NodeHandle n{};
 
     std::string footprint_frame, bin_frame, odometry_frame;
-    double rate;
+    double rate, burst_rate;
+    FiducialScheduler::Parameters schedule{};
     ros::param::param<std::string>("~footprint_frame", footprint_frame, "footprint");
     ros::param::param<std::string>("~bin_frame", bin_frame, "bin_footprint");
     ros::param::param<std::string>("~odometry_frame", odometry_frame, "odom");
     ros::param::param<double>("~rate",rate, 5);
+    ros::param::param<double>("~burst_rate", burst_rate, 10);
+    ros::param::param<double>("~still_speed", schedule.still_speed, 0.02);
+    ros::param::param<double>("~still_turn_rate", schedule.still_turn_rate, 0.02);
+    ros::param::param<double>("~burst_turn_rate", schedule.burst_turn_rate, 0.2);
+    ros::param::param<double>("~max_variance", schedule.max_variance, 0.05);
+    ros::param::param<double>("~max_yaw_variance", schedule.max_yaw_variance, 0.02);
+    ros::param::param<double>("~lost_timeout", schedule.lost_timeout, 10);
+    ros::param::param<double>("~resume_distance", schedule.resume_distance, 0.5);
+    ros::param::param<double>("~resume_angle", schedule.resume_angle, 0.5);
+    if (rate <= 0)
+        rate = 5;
+    burst_rate = std::max(burst_rate, rate);
+    schedule.normal_period = 1 / rate;
+    schedule.burst_period = 1 / burst_rate;
 
     FiducialOdom fiducial_odom{n, footprint_frame, bin_frame,
-        odometry_frame};
+        odometry_frame, schedule};
 
-    ros::Rate r(rate);
+    //ticks at the burst rate, most ticks don't look for the board
+    ros::Rate r(burst_rate);
     while(ros::ok())
     {
-        fiducial_odom.processOdometry(false);
         ros::spinOnce();
+        fiducial_odom.update();
         r.sleep();
     }
 
@@ -1,76 +1,16 @@
 /**
- * wrapper for an image stream, allows the user to get the most recent image
- * from that stream on demand through a service. 
- *
- * The names of the service and sensor stream are configurable by the user.
- *
- * Subscribed Topics:
- * <camera_topic>: user suppplied
- * Provided Services:
- * <service_name>: user supplied
+ * Standalone node for the ImageWrapper, see
+ * tfr_sensor/include/tfr_sensor/image_wrapper.h for details. Prefer loading
+ * tfr_sensor/ImageWrapperNodelet into the camera's nodelet manager, which
+ * gets the frames from the driver without serializing them.
  *
  * Parameters:
  * ~camera_topic: the camera topic to subscribe to (string, default: "")
  * ~service_name: the name of the service to advertise (string, default: "")
- * 
- * Relevant Messages:
- * tfr_msgs::WrappedImage (srv)
+ * ~buffer_size: how many recent frames to keep (int, default: 30)
  * */
 #include <ros/ros.h>
-#include <ros/console.h>
-#include <sensor_msgs/Image.h>
-#include <image_transport/image_transport.h>
-#include <tfr_msgs/WrappedImage.h>
-
-class ImageWrapper
-{
-    public:
-
-        ImageWrapper(ros::NodeHandle &n, const std::string &camera_topic,
-                const std::string &service_name)
-        {
-            image_transport::ImageTransport it{n};
-            subscriber = it.subscribeCamera(camera_topic, 20, &ImageWrapper::set_current, this);
-            server = n.advertiseService(service_name, &ImageWrapper::get_current, this);
-        }
-        
-        ~ImageWrapper() = default;
-        ImageWrapper(const ImageWrapper&) = delete;
-        ImageWrapper& operator=(const ImageWrapper&) = delete;
-        ImageWrapper(ImageWrapper&&) = delete;
-        ImageWrapper& operator=(ImageWrapper&&) = delete;
-
-    private:
-
-        //subscription callback
-        void set_current(const sensor_msgs::ImageConstPtr &i, const
-                sensor_msgs::CameraInfoConstPtr &in)
-        {
-            //this is safe because of shared pointers and non threaded spinning
-            image = i;
-            info = in;
-        }
-
-        //service callback
-        bool get_current(tfr_msgs::WrappedImage::Request &request,
-                tfr_msgs::WrappedImage::Response &response)
-        {
-            /* we need some time to let the camera warm up and start publishing,
-             * so nullptr check needed*/
-            if (image != nullptr && info != nullptr)
-            {
-                response.image = *image;
-                response.camera_info= *info;
-                return true;
-            }
-            return false;
-        }
-        
-        image_transport::CameraSubscriber subscriber;
-        ros::ServiceServer server;
-        sensor_msgs::ImageConstPtr image{};
-        sensor_msgs::CameraInfoConstPtr info{};
-};
+#include "image_wrapper.h"
 
 int main(int argc, char **argv)
 {
@@ -79,6 +19,8 @@ int main(int argc, char **argv)
     std::string camera_topic{}, service_name{};
     ros::param::param<std::string>("~camera_topic", camera_topic, "");
     ros::param::param<std::string>("~service_name", service_name, "");
-    ImageWrapper wrapper{n, camera_topic, service_name};
+    int buffer_size;
+    ros::param::param<int>("~buffer_size", buffer_size, 30);
+    ImageWrapper wrapper{n, camera_topic, service_name, buffer_size};
     ros::spin();
 }
@@ -0,0 +1,77 @@
+#include "image_wrapper.h"
+
+ImageWrapper::ImageWrapper(ros::NodeHandle &n, const std::string &camera_topic,
+        const std::string &service_name, int buffer_size) :
+    frames(buffer_size > 0 ? buffer_size : 1)
+{
+    image_transport::ImageTransport it{n};
+    subscriber = it.subscribeCamera(camera_topic, 20, &ImageWrapper::set_current, this);
+    if (!service_name.empty())
+        server = n.advertiseService(service_name, &ImageWrapper::get_current, this);
+}
+
+/* we need some time to let the camera warm up and start publishing, so every
+ * lookup checks for an empty buffer*/
+bool ImageWrapper::latest(Frame &frame) const
+{
+    std::lock_guard<std::mutex> lock(image_mutex);
+    if (frames.empty())
+        return false;
+    frame = frames.newest().second;
+    return true;
+}
+
+bool ImageWrapper::nearest(const ros::Time &stamp, Frame &frame) const
+{
+    std::lock_guard<std::mutex> lock(image_mutex);
+    std::size_t index;
+    if (!frames.nearest(stamp, index))
+        return false;
+    frame = frames.at(index).second;
+    return true;
+}
+
+bool ImageWrapper::newerThan(const ros::Time &stamp, Frame &frame) const
+{
+    std::lock_guard<std::mutex> lock(image_mutex);
+    std::size_t index;
+    if (!frames.newerThan(stamp, index))
+        return false;
+    frame = frames.at(index).second;
+    return true;
+}
+
+void ImageWrapper::set_current(const sensor_msgs::ImageConstPtr &i, const
+        sensor_msgs::CameraInfoConstPtr &in)
+{
+    //only the pointers are stored, the frame itself is never copied here
+    std::lock_guard<std::mutex> lock(image_mutex);
+    frames.push(i->header.stamp, Frame{i, in});
+}
+
+bool ImageWrapper::lookup(uint8_t mode, const ros::Time &stamp, Frame &frame) const
+{
+    switch (mode)
+    {
+        case tfr_msgs::WrappedImage::Request::NEAREST:
+            return nearest(stamp, frame);
+        case tfr_msgs::WrappedImage::Request::NEWER_THAN:
+            return newerThan(stamp, frame);
+        case tfr_msgs::WrappedImage::Request::NEWEST_AFTER:
+            return latest(frame) && frame.image->header.stamp > stamp;
+        default:
+            return latest(frame);
+    }
+}
+
+bool ImageWrapper::get_current(tfr_msgs::WrappedImage::Request &request,
+        tfr_msgs::WrappedImage::Response &response)
+{
+    Frame frame{};
+    if (!lookup(request.mode, request.stamp, frame))
+        return false;
+    //copied outside of the lock so the camera isn't held up
+    response.image = *frame.image;
+    response.camera_info = *frame.info;
+    return true;
+}
@@ -0,0 +1,44 @@
+/**
+ * Nodelet version of the image_topic_wrapper. Loaded into the same manager as
+ * the camera driver the frames are handed over as shared pointers instead of
+ * being serialized, see tfr_sensor/include/tfr_sensor/image_wrapper.h.
+ *
+ * Parameters:
+ * ~camera_topic: the camera topic to subscribe to (string, default: "")
+ * ~service_name: the name of the service to advertise (string, default: "")
+ * ~buffer_size: how many recent frames to keep (int, default: 30)
+ * */
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+#include <memory>
+#include "image_wrapper.h"
+
+namespace tfr_sensor
+{
+    class ImageWrapperNodelet : public nodelet::Nodelet
+    {
+        public:
+            ImageWrapperNodelet() = default;
+            ~ImageWrapperNodelet() = default;
+            ImageWrapperNodelet(const ImageWrapperNodelet&) = delete;
+            ImageWrapperNodelet& operator=(const ImageWrapperNodelet&) = delete;
+            ImageWrapperNodelet(ImageWrapperNodelet&&) = delete;
+            ImageWrapperNodelet& operator=(ImageWrapperNodelet&&) = delete;
+
+        private:
+            void onInit() override
+            {
+                std::string camera_topic{}, service_name{};
+                getPrivateNodeHandle().param<std::string>("camera_topic", camera_topic, "");
+                getPrivateNodeHandle().param<std::string>("service_name", service_name, "");
+                int buffer_size;
+                getPrivateNodeHandle().param<int>("buffer_size", buffer_size, 30);
+                wrapper.reset(new ImageWrapper{getNodeHandle(), camera_topic,
+                        service_name, buffer_size});
+            }
+
+            std::unique_ptr<ImageWrapper> wrapper;
+    };
+}
+
+PLUGINLIB_EXPORT_CLASS(tfr_sensor::ImageWrapperNodelet, nodelet::Nodelet)
@@ -6,6 +6,8 @@
 
 #include <cv_bridge/cv_bridge.h>
 #include <sensor_msgs/image_encodings.h>
+#include <algorithm>
+#include <cstdint>
 
 
 /*
@@ -13,17 +15,42 @@
  *  Action message is empty,it merely signals the server to start processing.
  *  
  *  The server will not examine anything until commanded, and will set it's
- *  status to succeeded, when it sees the light.
+ *  status to succeeded, when it sees the light in window_size frames in a
+ *  row. Only the region of interest where the bin light appears is looked at,
+ *  and only every downscale'th pixel of it.
+ *
+ *  parameters:
+ *    ~threshold: how much bluer than the other channels the light makes the
+ *    region (double, default: 0.0)
+ *    ~window_size: consecutive frames the light has to be seen in (int,
+ *    default: 5)
+ *    ~roi_x, ~roi_y, ~roi_width, ~roi_height: the region of interest as
+ *    fractions of the image (double, default: the whole image)
+ *    ~downscale: pixel step inside the region (int, default: 4)
  * */
 class DetectionActionServer
 {
     public:
+        //where the light is expected, as fractions of the image size
+        struct Region
+        {
+            double x;
+            double y;
+            double width;
+            double height;
+        };
+
         DetectionActionServer(ros::NodeHandle &node, const std::string name,
-                int window_size,
-                double thresh) : 
+                int window,
+                double thresh,
+                const Region &r,
+                int step) : 
             n{node},
             server{node, name, false},
             threshold{thresh},
+            window_size{std::max(window, 1)},
+            region(r),
+            downscale{std::max(step, 1)},
             it{node}
         {
             server.registerGoalCallback(
@@ -56,6 +83,7 @@ class DetectionActionServer
         void setGoal()
         {
             ROS_INFO("DetectionActionServer accepted goal");
+            consecutive_hits = 0;
             server.acceptNewGoal();
         }
 
@@ -73,12 +101,11 @@ class DetectionActionServer
             if (!server.isActive() || !ros::ok())
                 return;
 
-            ColorStats stats{};
-            //convert out of std ros image
-            cv::Mat image;
+            //view the ros image in place, only converts if it isn't bgr
+            cv_bridge::CvImageConstPtr image;
             try
             {
-                image = cv_bridge::toCvCopy(msg)->image;
+                image = cv_bridge::toCvShare(msg, sensor_msgs::image_encodings::BGR8);
             }
             catch (cv_bridge::Exception& e)
             {
@@ -87,20 +114,70 @@ class DetectionActionServer
                 return;
             }
 
-            cv::Scalar intensities = cv::sum(image);
-
-            //note we have to reverse out of native cv bgr ordering
-            stats.r_ave = intensities[2]/(image.rows*image.cols);
-            stats.g_ave = intensities[1]/(image.rows*image.cols);
-            stats.b_ave = intensities[0]/(image.rows*image.cols);
+            ColorStats stats{};
+            if (!measure(image->image, stats))
+                return;
 
             if (stats.b_ave  > threshold*(stats.r_ave+stats.g_ave)/2)
+                ++consecutive_hits;
+            else
+                consecutive_hits = 0;
+
+            //a single bright frame isn't enough, it has to stay on
+            if (consecutive_hits >= window_size)
                 server.setSucceeded();
         }
 
+        /*
+         * Average color in the region of interest, sampling every downscale'th
+         * pixel in each direction. Sums are kept in integers, 640x480 of 255
+         * is well inside 64 bits.
+         * */
+        bool measure(const cv::Mat &image, ColorStats &stats)
+        {
+            cv::Rect bounds{0, 0, image.cols, image.rows};
+            cv::Rect roi = bounds & cv::Rect(
+                    static_cast<int>(region.x * image.cols),
+                    static_cast<int>(region.y * image.rows),
+                    static_cast<int>(region.width * image.cols),
+                    static_cast<int>(region.height * image.rows));
+            if (roi.area() == 0)
+            {
+                ROS_WARN_THROTTLE(5, "DetectionActionServer: empty region of interest");
+                return false;
+            }
+
+            uint64_t b = 0, g = 0, r = 0, samples = 0;
+            const int stride = 3 * downscale;
+            for (int row = roi.y; row < roi.y + roi.height; row += downscale)
+            {
+                const uint8_t *pixel = image.ptr<uint8_t>(row) + 3 * roi.x;
+                const uint8_t *end = pixel + 3 * roi.width;
+                for (; pixel < end; pixel += stride)
+                {
+                    b += pixel[0];
+                    g += pixel[1];
+                    r += pixel[2];
+                    ++samples;
+                }
+            }
+
+            //note we have to reverse out of native cv bgr ordering
+            stats.r_ave = static_cast<double>(r) / samples;
+            stats.g_ave = static_cast<double>(g) / samples;
+            stats.b_ave = static_cast<double>(b) / samples;
+            stats.initialized = true;
+            return true;
+        }
+
 
         ros::NodeHandle &n;
         double threshold;
+        const int window_size;
+        const Region region;
+        const int downscale;
+        //frames in a row the light has been seen in, for the current goal
+        int consecutive_hits{};
         actionlib::SimpleActionServer<tfr_msgs::EmptyAction> server;
         image_transport::ImageTransport it;
         image_transport::Subscriber image_subscriber;
@@ -112,12 +189,19 @@ int main(int argc, char**argv)
     ros::init(argc, argv, "light_detection_action_server");
     ros::NodeHandle n;
 
-    int window_size;
+    int window_size, downscale;
     double threshold;
+    DetectionActionServer::Region region{};
     ros::param::param<double>("~threshold", threshold, 0.0);
+    ros::param::param<int>("~window_size", window_size, 5);
+    ros::param::param<double>("~roi_x", region.x, 0.0);
+    ros::param::param<double>("~roi_y", region.y, 0.0);
+    ros::param::param<double>("~roi_width", region.width, 1.0);
+    ros::param::param<double>("~roi_height", region.height, 1.0);
+    ros::param::param<int>("~downscale", downscale, 4);
     
     DetectionActionServer server{n, "light_detection", 
-            window_size, threshold};
+            window_size, threshold, region, downscale};
 
     ros::spin();
     return 0;
@@ -0,0 +1,207 @@
+#include "obstacle_filter.h"
+#include <tf2_geometry_msgs/tf2_geometry_msgs.h>
+#include <boost/make_shared.hpp>
+#include <opencv2/core/utility.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+ObstacleFilter::ObstacleFilter(ros::NodeHandle& n, const Parameters& p) :
+    parameters(p),
+    tf_buffer{},
+    tf_listener{tf_buffer},
+    generator{}
+{
+    publisher = n.advertise<sensor_msgs::PointCloud2>("obstacles", 5);
+    subscriber = n.subscribe("points", 2, &ObstacleFilter::filter, this);
+}
+
+void ObstacleFilter::filter(const sensor_msgs::PointCloud2ConstPtr& cloud)
+{
+    int offsets[3] = {-1, -1, -1};
+    const char *names[3] = {"x", "y", "z"};
+    for (const auto &field : cloud->fields)
+        for (int i = 0; i < 3; ++i)
+            if (field.name == names[i] &&
+                    field.datatype == sensor_msgs::PointField::FLOAT32)
+                offsets[i] = field.offset;
+    if (offsets[0] < 0 || offsets[1] < 0 || offsets[2] < 0 || cloud->is_bigendian)
+    {
+        ROS_WARN_THROTTLE(5, "ObstacleFilter: cloud has no float xyz fields");
+        return;
+    }
+
+    tf2::Transform transform{};
+    try
+    {
+        auto stamped = tf_buffer.lookupTransform(parameters.target_frame,
+                cloud->header.frame_id, cloud->header.stamp, ros::Duration(0.1));
+        tf2::fromMsg(stamped.transform, transform);
+    }
+    catch (tf2::TransformException &ex)
+    {
+        ROS_WARN_THROTTLE(5, "ObstacleFilter: %s", ex.what());
+        return;
+    }
+
+    //each slice of rows gets its own grid, merged afterwards, the slices run
+    //on opencv's thread pool instead of spawning threads every cloud
+    int slices = std::max(1, std::min<int>(parameters.threads, cloud->height));
+    std::vector<VoxelGrid> grids(slices);
+    cv::parallel_for_(cv::Range(0, slices), [&](const cv::Range &range)
+            {
+                for (int i = range.start; i < range.end; ++i)
+                {
+                    uint32_t begin = cloud->height * i / slices;
+                    uint32_t end = cloud->height * (i + 1) / slices;
+                    voxelize(*cloud, offsets, transform, begin, end, grids[i]);
+                }
+            }, slices);
+
+    auto &grid = grids.front();
+    for (int i = 1; i < slices; ++i)
+        for (const auto &cell : grids[i])
+        {
+            auto &voxel = grid[cell.first];
+            voxel.x += cell.second.x;
+            voxel.y += cell.second.y;
+            voxel.z += cell.second.z;
+            voxel.count += cell.second.count;
+        }
+
+    std::vector<tf2::Vector3> centroids{};
+    centroids.reserve(grid.size());
+    for (const auto &cell : grid)
+        centroids.emplace_back(cell.second.x / cell.second.count,
+                cell.second.y / cell.second.count,
+                cell.second.z / cell.second.count);
+
+    //fall back to the footprint plane if the floor can't be found
+    Plane ground{tf2::Vector3{0, 0, 1}, 0};
+    fitGround(centroids, ground);
+
+    auto output = boost::make_shared<sensor_msgs::PointCloud2>();
+    output->header.stamp = cloud->header.stamp;
+    output->header.frame_id = parameters.target_frame;
+    output->fields.resize(3);
+    for (int i = 0; i < 3; ++i)
+    {
+        output->fields[i].name = names[i];
+        output->fields[i].offset = 4 * i;
+        output->fields[i].datatype = sensor_msgs::PointField::FLOAT32;
+        output->fields[i].count = 1;
+    }
+    output->is_bigendian = false;
+    output->is_dense = true;
+    output->point_step = 12;
+    output->height = 1;
+    output->data.reserve(12 * centroids.size());
+    for (const auto &point : centroids)
+    {
+        double height = ground.normal.dot(point) + ground.d;
+        if (height < parameters.min_height || height > parameters.max_height)
+            continue;
+        float xyz[3] = {static_cast<float>(point.x()),
+            static_cast<float>(point.y()), static_cast<float>(point.z())};
+        auto size = output->data.size();
+        output->data.resize(size + sizeof(xyz));
+        std::memcpy(output->data.data() + size, xyz, sizeof(xyz));
+    }
+    output->width = output->data.size() / output->point_step;
+    output->row_step = output->data.size();
+    publisher.publish(output);
+}
+
+void ObstacleFilter::voxelize(const sensor_msgs::PointCloud2& cloud,
+        const int offsets[3], const tf2::Transform& transform, uint32_t begin,
+        uint32_t end, VoxelGrid& grid) const
+{
+    //anything below the floor by this much is noise, not a hole we can see
+    const double floor = -parameters.max_height;
+    for (uint32_t row = begin; row < end; ++row)
+    {
+        const uint8_t *point = cloud.data.data() + row * cloud.row_step;
+        for (uint32_t column = 0; column < cloud.width; ++column, point += cloud.point_step)
+        {
+            float xyz[3];
+            for (int i = 0; i < 3; ++i)
+                std::memcpy(&xyz[i], point + offsets[i], sizeof(float));
+            if (!std::isfinite(xyz[0]) || !std::isfinite(xyz[1]) || !std::isfinite(xyz[2]))
+                continue;
+
+            auto p = transform(tf2::Vector3{xyz[0], xyz[1], xyz[2]});
+            if (std::abs(p.x()) > parameters.max_range ||
+                    std::abs(p.y()) > parameters.max_range ||
+                    p.z() < floor || p.z() > parameters.max_height)
+                continue;
+
+            auto &voxel = grid[voxelKey(p.x(), p.y(), p.z())];
+            voxel.x += p.x();
+            voxel.y += p.y();
+            voxel.z += p.z();
+            ++voxel.count;
+        }
+    }
+}
+
+/*
+ * Packs the voxel indices into 21 bits each, plenty for a few meters at a few
+ * centimeters.
+ * */
+int64_t ObstacleFilter::voxelKey(double x, double y, double z) const
+{
+    const int64_t bias = 1 << 20, mask = (1 << 21) - 1;
+    int64_t i = static_cast<int64_t>(std::floor(x / parameters.voxel_size)) + bias;
+    int64_t j = static_cast<int64_t>(std::floor(y / parameters.voxel_size)) + bias;
+    int64_t k = static_cast<int64_t>(std::floor(z / parameters.voxel_size)) + bias;
+    return ((i & mask) << 42) | ((j & mask) << 21) | (k & mask);
+}
+
+/*
+ * Fits planes through random triples of the low points and keeps the one
+ * with the most points within ground_threshold. Planes tilted more than
+ * MAX_SLOPE are walls or rocks, not the floor.
+ * */
+bool ObstacleFilter::fitGround(const std::vector<tf2::Vector3>& points, Plane& plane)
+{
+    const int ITERATIONS = 50;
+    const double MAX_SLOPE = 0.35; //radians
+    const std::size_t MIN_INLIERS = 10;
+
+    std::vector<tf2::Vector3> candidates{};
+    for (const auto &point : points)
+        if (std::abs(point.z()) < parameters.min_height * 2)
+            candidates.push_back(point);
+    if (candidates.size() < MIN_INLIERS)
+        return false;
+
+    std::uniform_int_distribution<std::size_t> pick(0, candidates.size() - 1);
+    std::size_t best_inliers = 0;
+    for (int i = 0; i < ITERATIONS; ++i)
+    {
+        const auto &a = candidates[pick(generator)];
+        const auto &b = candidates[pick(generator)];
+        const auto &c = candidates[pick(generator)];
+        auto normal = (b - a).cross(c - a);
+        if (normal.length2() < 1e-12)
+            continue;
+        normal.normalize();
+        if (normal.z() < 0)
+            normal = -normal;
+        if (std::acos(normal.z()) > MAX_SLOPE)
+            continue;
+        double d = -normal.dot(a);
+
+        std::size_t inliers = 0;
+        for (const auto &point : candidates)
+            if (std::abs(normal.dot(point) + d) < parameters.ground_threshold)
+                ++inliers;
+        if (inliers > best_inliers)
+        {
+            best_inliers = inliers;
+            plane.normal = normal;
+            plane.d = d;
+        }
+    }
+    return best_inliers >= MIN_INLIERS;
+}
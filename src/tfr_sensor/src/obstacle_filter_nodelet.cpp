@@ -0,0 +1,56 @@
+/**
+ * Nodelet for the ObstacleFilter, see
+ * tfr_sensor/include/tfr_sensor/obstacle_filter.h. Load it into the depth
+ * driver's manager so the full clouds are never serialized.
+ *
+ * Parameters:
+ * ~target_frame: the robot frame to filter in (string, default: "base_footprint")
+ * ~max_range: half the side of the crop box [m] (double, default: 2.5)
+ * ~min_height: lowest obstacle above the ground [m] (double, default: 0.11)
+ * ~max_height: highest obstacle above the ground [m] (double, default: 1.0)
+ * ~voxel_size: side of a voxel [m] (double, default: 0.05)
+ * ~ground_threshold: ground plane inlier distance [m] (double, default: 0.04)
+ * ~threads: slices processed in parallel (int, default: 4)
+ * */
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+#include <memory>
+#include "obstacle_filter.h"
+
+namespace tfr_sensor
+{
+    class ObstacleFilterNodelet : public nodelet::Nodelet
+    {
+        public:
+            ObstacleFilterNodelet() = default;
+            ~ObstacleFilterNodelet() = default;
+            ObstacleFilterNodelet(const ObstacleFilterNodelet&) = delete;
+            ObstacleFilterNodelet& operator=(const ObstacleFilterNodelet&) = delete;
+            ObstacleFilterNodelet(ObstacleFilterNodelet&&) = delete;
+            ObstacleFilterNodelet& operator=(ObstacleFilterNodelet&&) = delete;
+
+        private:
+            void onInit() override
+            {
+                auto &pn = getPrivateNodeHandle();
+                ObstacleFilter::Parameters parameters{};
+                pn.param<std::string>("target_frame", parameters.target_frame, "base_footprint");
+                pn.param<double>("max_range", parameters.max_range, 2.5);
+                pn.param<double>("min_height", parameters.min_height, 0.11);
+                pn.param<double>("max_height", parameters.max_height, 1.0);
+                pn.param<double>("voxel_size", parameters.voxel_size, 0.05);
+                pn.param<double>("ground_threshold", parameters.ground_threshold, 0.04);
+                pn.param<int>("threads", parameters.threads, 4);
+                if (parameters.voxel_size <= 0)
+                {
+                    NODELET_WARN("ObstacleFilter: voxel_size has to be positive, using 0.05");
+                    parameters.voxel_size = 0.05;
+                }
+                filter.reset(new ObstacleFilter{getNodeHandle(), parameters});
+            }
+
+            std::unique_ptr<ObstacleFilter> filter;
+    };
+}
+
+PLUGINLIB_EXPORT_CLASS(tfr_sensor::ObstacleFilterNodelet, nodelet::Nodelet)
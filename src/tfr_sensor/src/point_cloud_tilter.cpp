@@ -0,0 +1,178 @@
+#include "point_cloud_tilter.h"
+#include <geometry_msgs/TransformStamped.h>
+#include <boost/make_shared.hpp>
+#include <cmath>
+#include <cstring>
+
+PointCloudTilter::PointCloudTilter(ros::NodeHandle& n, const std::string& p_f,
+        const std::string& c_f):
+    parent_frame{p_f},
+    child_frame{c_f},
+    br{},
+    //a couple seconds of imu, covers how far behind the clouds get
+    orientations{400}
+{
+    //callbacks can start as soon as we subscribe, so everything they touch
+    //has to be built first
+    tilt_publisher = n.advertise<sensor_msgs::PointCloud2>("tilted_points", 5);
+    imu_subscriber = n.subscribe("imu", 10, &PointCloudTilter::storeImu, this);
+    data_subscriber = n.subscribe("points", 10, &PointCloudTilter::tiltData, this);
+}
+
+bool PointCloudTilter::rotate(const sensor_msgs::PointCloud2& in,
+        const tf2::Matrix3x3& rotation, sensor_msgs::PointCloud2& out)
+{
+    int offsets[3] = {-1, -1, -1};
+    const char *names[3] = {"x", "y", "z"};
+    for (const auto &field : in.fields)
+        for (int i = 0; i < 3; ++i)
+            if (field.name == names[i] &&
+                    field.datatype == sensor_msgs::PointField::FLOAT32)
+                offsets[i] = field.offset;
+    if (offsets[0] < 0 || offsets[1] < 0 || offsets[2] < 0 || in.is_bigendian)
+        return false;
+
+    out.height = in.height;
+    out.width = in.width;
+    out.fields.resize(3);
+    for (int i = 0; i < 3; ++i)
+    {
+        out.fields[i].name = names[i];
+        out.fields[i].offset = 4 * i;
+        out.fields[i].datatype = sensor_msgs::PointField::FLOAT32;
+        out.fields[i].count = 1;
+    }
+    out.is_bigendian = false;
+    out.point_step = 12;
+    out.row_step = out.point_step * out.width;
+    out.is_dense = in.is_dense;
+    //keeps its capacity when reused, so this only allocates the first time
+    out.data.resize(out.row_step * out.height);
+
+    const float r00 = rotation[0][0], r01 = rotation[0][1], r02 = rotation[0][2];
+    const float r10 = rotation[1][0], r11 = rotation[1][1], r12 = rotation[1][2];
+    const float r20 = rotation[2][0], r21 = rotation[2][1], r22 = rotation[2][2];
+    float *target = reinterpret_cast<float*>(out.data.data());
+    for (uint32_t row = 0; row < in.height; ++row)
+    {
+        const uint8_t *point = in.data.data() + row * in.row_step;
+        for (uint32_t column = 0; column < in.width; ++column, point += in.point_step)
+        {
+            float x, y, z;
+            std::memcpy(&x, point + offsets[0], sizeof(float));
+            std::memcpy(&y, point + offsets[1], sizeof(float));
+            std::memcpy(&z, point + offsets[2], sizeof(float));
+            //nan stays nan, so invalid points stay invalid
+            *target++ = r00 * x + r01 * y + r02 * z;
+            *target++ = r10 * x + r11 * y + r12 * z;
+            *target++ = r20 * x + r21 * y + r22 * z;
+        }
+    }
+    return true;
+}
+
+void PointCloudTilter::publishTransform(const ros::Time& stamp,
+        const tf2::Quaternion& tilt)
+{
+    geometry_msgs::TransformStamped transformStamped;
+    transformStamped.header.stamp = stamp;
+    transformStamped.header.frame_id = parent_frame;
+    transformStamped.child_frame_id = child_frame;
+    transformStamped.transform.rotation.w = tilt.getW();
+    transformStamped.transform.rotation.x = tilt.getX();
+    transformStamped.transform.rotation.y = tilt.getY();
+    transformStamped.transform.rotation.z = tilt.getZ();
+    br.sendTransform(transformStamped);
+}
+
+void PointCloudTilter::tiltData(const sensor_msgs::PointCloud2ConstPtr& cloudPtr)
+{
+    //the last one is still queued somewhere, it can't be touched
+    if (output == nullptr || !output.unique())
+        output = boost::make_shared<sensor_msgs::PointCloud2>();
+
+    auto tilt = getTilt(cloudPtr->header.stamp);
+    if (!rotate(*cloudPtr, tf2::Matrix3x3(tilt), *output))
+    {
+        ROS_WARN_THROTTLE(5, "PointCloudTilter: cloud has no float xyz fields");
+        return;
+    }
+    output->header = cloudPtr->header;
+    output->header.frame_id = parent_frame;
+    tilt_publisher.publish(output);
+    publishTransform(cloudPtr->header.stamp, tilt);
+}
+
+void PointCloudTilter::storeImu(const sensor_msgs::ImuConstPtr &imu)
+{
+    tf2::Quaternion orientation{imu->orientation.x, imu->orientation.y,
+        imu->orientation.z, imu->orientation.w};
+    std::lock_guard<std::mutex> lock(imu_mutex);
+    orientations.push(imu->header.stamp, orientation);
+}
+
+/*
+ * Slerps between the orientations on either side of the stamp. Stamps outside
+ * of the buffer get the closest end, the imu is faster than the clouds so
+ * that is rarely more than one imu period off.
+ * */
+bool PointCloudTilter::orientationAt(const ros::Time& stamp,
+        tf2::Quaternion& orientation)
+{
+    std::lock_guard<std::mutex> lock(imu_mutex);
+    if (orientations.empty())
+        return false;
+    std::size_t lower;
+    if (!orientations.atOrBefore(stamp, lower))
+    {
+        orientation = orientations.oldest().second;
+        return true;
+    }
+    if (lower + 1 == orientations.size())
+    {
+        orientation = orientations.newest().second;
+        return true;
+    }
+    const auto &before = orientations.at(lower);
+    const auto &after = orientations.at(lower + 1);
+    double ratio = (stamp - before.first).toSec() / (after.first - before.first).toSec();
+    orientation = before.second.slerp(after.second, ratio);
+    return true;
+}
+
+tf2::Quaternion PointCloudTilter::getTilt(const ros::Time& stamp)
+{
+    tf2::Quaternion q_0{0, 0, 0, 1};
+    tf2::Quaternion orientation{};
+    if (!orientationAt(stamp, orientation))
+        return q_0;
+
+    double pitch, roll;
+    // roll (x-axis rotation)
+    double sinr = +2.0 * (orientation.w() * orientation.x() +
+            orientation.y() * orientation.z());
+    double cosr = +1.0 - 2.0 * (orientation.x() *
+            orientation.x() + orientation.y() *
+            orientation.y());
+    roll = atan2(sinr, cosr);
+
+    // pitch (y-axis rotation)
+    double sinp = +2.0 * (orientation.w() * orientation.y()
+            - orientation.z() * orientation.x());
+
+    if (fabs(sinp) >= 1)
+        pitch = copysign(M_PI / 2, sinp); // use 90 degrees if out of range
+    else
+        pitch = asin(sinp);
+
+    //the imu reports body to world, levelling a body frame point is the
+    //same roll and pitch with the yaw left out
+    tf2::Quaternion level{};
+    level.setRPY(roll, pitch, 0);
+    //those are about the robot's axes (x forward, z up), the cloud is in
+    //the optical axes (z forward, y down)
+    tf2::Matrix3x3 rotation = LINK_TO_OPTICAL * tf2::Matrix3x3{level} *
+        LINK_TO_OPTICAL.transpose();
+    rotation.getRotation(q_0);
+    return q_0;
+}
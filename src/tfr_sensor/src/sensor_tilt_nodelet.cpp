@@ -0,0 +1,40 @@
+/**
+ * Nodelet version of sensor_tilt. Loaded into the same manager as the depth
+ * driver the clouds are handed over as shared pointers instead of being
+ * serialized, see tfr_sensor/include/tfr_sensor/point_cloud_tilter.h.
+ *
+ * Parameters:
+ * ~parent_frame: the frame of the sensor (string, default: "")
+ * ~child_frame: the tilt corrected frame to broadcast (string, default: "")
+ * */
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+#include <memory>
+#include "point_cloud_tilter.h"
+
+namespace tfr_sensor
+{
+    class SensorTiltNodelet : public nodelet::Nodelet
+    {
+        public:
+            SensorTiltNodelet() = default;
+            ~SensorTiltNodelet() = default;
+            SensorTiltNodelet(const SensorTiltNodelet&) = delete;
+            SensorTiltNodelet& operator=(const SensorTiltNodelet&) = delete;
+            SensorTiltNodelet(SensorTiltNodelet&&) = delete;
+            SensorTiltNodelet& operator=(SensorTiltNodelet&&) = delete;
+
+        private:
+            void onInit() override
+            {
+                std::string parent_frame{}, child_frame{};
+                getPrivateNodeHandle().param<std::string>("parent_frame", parent_frame, "");
+                getPrivateNodeHandle().param<std::string>("child_frame", child_frame, "");
+                tilter.reset(new PointCloudTilter{getNodeHandle(), parent_frame, child_frame});
+            }
+
+            std::unique_ptr<PointCloudTilter> tilter;
+    };
+}
+
+PLUGINLIB_EXPORT_CLASS(tfr_sensor::SensorTiltNodelet, nodelet::Nodelet)
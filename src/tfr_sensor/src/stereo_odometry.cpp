@@ -0,0 +1,262 @@
+#include "stereo_odometry.h"
+#include <opencv2/calib3d.hpp>
+#include <algorithm>
+#include <future>
+#include <functional>
+
+namespace
+{
+    //inverse of a rigid transform, without a general 4x4 inversion
+    cv::Matx44d invert(const cv::Matx44d &t)
+    {
+        cv::Matx44d inverse = cv::Matx44d::eye();
+        for (int i = 0; i < 3; ++i)
+        {
+            for (int j = 0; j < 3; ++j)
+                inverse(i, j) = t(j, i);
+            inverse(i, 3) = -(t(0, i) * t(0, 3) + t(1, i) * t(1, 3) + t(2, i) * t(2, 3));
+        }
+        return inverse;
+    }
+
+    cv::Point3f apply(const cv::Matx44d &t, const cv::Point3f &p)
+    {
+        return cv::Point3f(
+                t(0, 0) * p.x + t(0, 1) * p.y + t(0, 2) * p.z + t(0, 3),
+                t(1, 0) * p.x + t(1, 1) * p.y + t(1, 2) * p.z + t(1, 3),
+                t(2, 0) * p.x + t(2, 1) * p.y + t(2, 2) * p.z + t(2, 3));
+    }
+
+    //the same landmark seen from two keyframes, closer than this is a duplicate [m]
+    const double DUPLICATE_DISTANCE = 0.1;
+}
+
+StereoOdometry::StereoOdometry(const Parameters &p) :
+    parameters(p),
+    left_detector{cv::ORB::create(p.features, 1.2f, 4, 31, 0, 2,
+            cv::ORB::FAST_SCORE, 31, p.fast_threshold)},
+    right_detector{cv::ORB::create(p.features, 1.2f, 4, 31, 0, 2,
+            cv::ORB::FAST_SCORE, 31, p.fast_threshold)},
+    keyframes{},
+    pose{cv::Matx44d::eye()},
+    tracking{false}
+{ }
+
+void StereoOdometry::reset()
+{
+    keyframes.clear();
+    pose = cv::Matx44d::eye();
+    tracking = false;
+}
+
+/*
+ * Detection is most of the work, so the two images are done at once, then
+ * tracking the left image runs alongside the stereo matching for the next
+ * keyframe.
+ * */
+bool StereoOdometry::process(const cv::Mat &left, const cv::Mat &right,
+        const Calibration &calibration, cv::Matx44d &motion, int &inliers)
+{
+    std::vector<cv::KeyPoint> left_keypoints{}, right_keypoints{};
+    cv::Mat left_descriptors{}, right_descriptors{};
+    auto right_detected = std::async(std::launch::async, &StereoOdometry::detect,
+            std::ref(*right_detector), std::cref(right), std::ref(right_keypoints),
+            std::ref(right_descriptors));
+    detect(*left_detector, left, left_keypoints, left_descriptors);
+    right_detected.get();
+
+    cv::Matx44d current = pose;
+    inliers = 0;
+    std::future<bool> tracked{};
+    if (tracking)
+        tracked = std::async(std::launch::async, &StereoOdometry::track, this,
+                std::cref(left_keypoints), std::cref(left_descriptors),
+                std::cref(calibration), std::ref(current), std::ref(inliers));
+
+    std::vector<cv::Point3f> points{};
+    cv::Mat descriptors{};
+    triangulate(left_keypoints, left_descriptors, right_keypoints,
+            right_descriptors, calibration, points, descriptors);
+
+    if (!tracking || !tracked.get())
+    {
+        //start over from this pair, where we are in the world doesn't matter
+        keyframes.clear();
+        addKeyframe(points, descriptors, pose);
+        tracking = static_cast<int>(points.size()) >= parameters.min_inliers;
+        return false;
+    }
+
+    motion = invert(pose) * current;
+    pose = current;
+    if (inliers < parameters.keyframe_inliers)
+        addKeyframe(points, descriptors, pose);
+    return true;
+}
+
+void StereoOdometry::detect(cv::ORB &detector, const cv::Mat &image,
+        std::vector<cv::KeyPoint> &keypoints, cv::Mat &descriptors)
+{
+    detector.detectAndCompute(image, cv::noArray(), keypoints, descriptors);
+}
+
+/*
+ * The pair is rectified, so a left feature's match lies on the same row of
+ * the right image, a little to the left. Right features are bucketed by row
+ * so each left feature only looks at a few rows. Matches that are nearly as
+ * good as the runner up are dropped, the regolith is full of look alikes.
+ * */
+void StereoOdometry::triangulate(const std::vector<cv::KeyPoint> &left_keypoints,
+        const cv::Mat &left_descriptors,
+        const std::vector<cv::KeyPoint> &right_keypoints,
+        const cv::Mat &right_descriptors, const Calibration &calibration,
+        std::vector<cv::Point3f> &points, cv::Mat &descriptors) const
+{
+    points.clear();
+    descriptors.release();
+    if (left_keypoints.empty() || right_keypoints.empty())
+        return;
+
+    int height = 0;
+    for (const auto &keypoint : right_keypoints)
+        height = std::max(height, static_cast<int>(keypoint.pt.y) + 1);
+    std::vector<std::vector<int>> rows(height);
+    for (int j = 0; j < static_cast<int>(right_keypoints.size()); ++j)
+        rows[static_cast<int>(right_keypoints[j].pt.y)].push_back(j);
+
+    const double depth_scale = calibration.fx * calibration.baseline;
+    for (int i = 0; i < static_cast<int>(left_keypoints.size()); ++i)
+    {
+        const auto &point = left_keypoints[i].pt;
+        int row = static_cast<int>(point.y);
+        int best = -1;
+        double best_distance = parameters.max_distance + 1, second_distance = 256;
+        for (int r = std::max(0, row - parameters.row_tolerance);
+                r <= std::min(height - 1, row + parameters.row_tolerance); ++r)
+        {
+            for (int j : rows[r])
+            {
+                double disparity = point.x - right_keypoints[j].pt.x;
+                if (disparity < parameters.min_disparity ||
+                        disparity > parameters.max_disparity)
+                    continue;
+                double distance = cv::norm(left_descriptors.row(i),
+                        right_descriptors.row(j), cv::NORM_HAMMING);
+                if (distance < best_distance)
+                {
+                    second_distance = best_distance;
+                    best_distance = distance;
+                    best = j;
+                }
+                else if (distance < second_distance)
+                    second_distance = distance;
+            }
+        }
+        if (best < 0 || best_distance > parameters.max_distance ||
+                best_distance > parameters.ratio * second_distance)
+            continue;
+
+        double z = depth_scale / (point.x - right_keypoints[best].pt.x);
+        points.emplace_back((point.x - calibration.cx) * z / calibration.fx,
+                (point.y - calibration.cy) * z / calibration.fy, z);
+        descriptors.push_back(left_descriptors.row(i));
+    }
+}
+
+/*
+ * Matches the left features against every point in the window and solves for
+ * the camera pose, starting from the last one.
+ * */
+bool StereoOdometry::track(const std::vector<cv::KeyPoint> &keypoints,
+        const cv::Mat &descriptors, const Calibration &calibration,
+        cv::Matx44d &current, int &inliers) const
+{
+    std::vector<cv::Point3f> window_points{};
+    cv::Mat window_descriptors{};
+    for (const auto &keyframe : keyframes)
+    {
+        window_points.insert(window_points.end(), keyframe.points.begin(),
+                keyframe.points.end());
+        window_descriptors.push_back(keyframe.descriptors);
+    }
+    if (descriptors.empty() ||
+            static_cast<int>(window_points.size()) < parameters.min_inliers)
+        return false;
+
+    cv::BFMatcher matcher{cv::NORM_HAMMING};
+    std::vector<std::vector<cv::DMatch>> matches{};
+    matcher.knnMatch(descriptors, window_descriptors, matches, 2);
+
+    std::vector<cv::Point3f> object{};
+    std::vector<cv::Point2f> image{};
+    for (const auto &match : matches)
+    {
+        if (match.empty() || match[0].distance > parameters.max_distance)
+            continue;
+        //a runner up that is the same landmark from another keyframe is fine
+        if (match.size() > 1 && match[0].distance > parameters.ratio * match[1].distance &&
+                cv::norm(window_points[match[0].trainIdx] -
+                    window_points[match[1].trainIdx]) > DUPLICATE_DISTANCE)
+            continue;
+        object.push_back(window_points[match[0].trainIdx]);
+        image.push_back(keypoints[match[0].queryIdx].pt);
+    }
+    if (static_cast<int>(object.size()) < parameters.min_inliers)
+        return false;
+
+    cv::Matx33d k{calibration.fx, 0, calibration.cx,
+        0, calibration.fy, calibration.cy,
+        0, 0, 1};
+    cv::Matx44d world_to_camera = invert(pose);
+    cv::Matx33d rotation{};
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            rotation(i, j) = world_to_camera(i, j);
+    cv::Mat rvec{}, tvec = (cv::Mat_<double>(3, 1) <<
+            world_to_camera(0, 3), world_to_camera(1, 3), world_to_camera(2, 3));
+    cv::Rodrigues(rotation, rvec);
+
+    std::vector<int> inlier_indices{};
+    if (!cv::solvePnPRansac(object, image, k, cv::noArray(), rvec, tvec, true, 100,
+                parameters.reprojection_error, 0.99, inlier_indices) ||
+            static_cast<int>(inlier_indices.size()) < parameters.min_inliers)
+        return false;
+
+    //levenberg-marquardt on the inliers only
+    std::vector<cv::Point3f> inlier_object{};
+    std::vector<cv::Point2f> inlier_image{};
+    for (int index : inlier_indices)
+    {
+        inlier_object.push_back(object[index]);
+        inlier_image.push_back(image[index]);
+    }
+    cv::solvePnP(inlier_object, inlier_image, k, cv::noArray(), rvec, tvec, true,
+            cv::SOLVEPNP_ITERATIVE);
+
+    cv::Rodrigues(rvec, rotation);
+    world_to_camera = cv::Matx44d::eye();
+    for (int i = 0; i < 3; ++i)
+    {
+        for (int j = 0; j < 3; ++j)
+            world_to_camera(i, j) = rotation(i, j);
+        world_to_camera(i, 3) = tvec.at<double>(i);
+    }
+    current = invert(world_to_camera);
+    inliers = static_cast<int>(inlier_indices.size());
+    return true;
+}
+
+void StereoOdometry::addKeyframe(const std::vector<cv::Point3f> &points,
+        const cv::Mat &descriptors, const cv::Matx44d &camera_to_world)
+{
+    if (points.empty())
+        return;
+    Keyframe keyframe{};
+    keyframe.points.reserve(points.size());
+    for (const auto &point : points)
+        keyframe.points.push_back(apply(camera_to_world, point));
+    keyframe.descriptors = descriptors.clone();
+    keyframes.push_back(std::move(keyframe));
+    while (static_cast<int>(keyframes.size()) > std::max(parameters.window, 1))
+        keyframes.pop_front();
+}
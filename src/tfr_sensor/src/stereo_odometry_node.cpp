@@ -0,0 +1,227 @@
+/**
+ * Visual odometry from the DUO3D stereo pair, see
+ * tfr_sensor/include/tfr_sensor/stereo_odometry.h for the tracking itself.
+ *
+ * The camera's motion between pairs is moved into the robot frame and
+ * published as a forward speed and turn rate, which the drive ekf fuses like
+ * the tread odometry. Unlike the treads it doesn't slip in the regolith, so
+ * it carries the pose between fiducial fixes. The pose is integrated too, for
+ * looking at in rviz.
+ *
+ * The images have to be rectified, and the camera's optical frame has to be
+ * in tf.
+ *
+ * parameters:
+ *   ~odom_frame: (string, default: "odom")
+ *   ~base_frame: (string, default: "base_footprint")
+ *   ~features: ORB features per image (int, default: 500)
+ *   ~fast_threshold: (int, default: 20)
+ *   ~window: keyframes tracked against (int, default: 3)
+ *   ~max_distance: worst descriptor match, out of 256 bits (int, default: 64)
+ *   ~ratio: best to second best match ratio (double, default: 0.8)
+ *   ~row_tolerance: rows searched for a stereo match [px] (int, default: 2)
+ *   ~min_disparity, ~max_disparity: [px] (double, default: 1, 100)
+ *   ~reprojection_error: RANSAC inlier threshold [px] (double, default: 2.0)
+ *   ~min_inliers: fewer and tracking is lost (int, default: 20)
+ *   ~keyframe_inliers: fewer and a keyframe is added (int, default: 80)
+ *   ~velocity_variance, ~turn_rate_variance: at min_inliers, shrinks with
+ *   more inliers (double, default: 0.01, 0.01)
+ * subscribed topics:
+ *   left/image_rect, right/image_rect (sensor_msgs/Image)
+ *   left/camera_info, right/camera_info (sensor_msgs/CameraInfo)
+ * published topics:
+ *   visual_odom (nav_msgs/Odometry)
+ * */
+#include <ros/ros.h>
+#include <nav_msgs/Odometry.h>
+#include <sensor_msgs/Image.h>
+#include <sensor_msgs/CameraInfo.h>
+#include <message_filters/subscriber.h>
+#include <message_filters/time_synchronizer.h>
+#include <cv_bridge/cv_bridge.h>
+#include <tf2_ros/buffer.h>
+#include <tf2_ros/transform_listener.h>
+#include <tf2/LinearMath/Transform.h>
+#include <tf2/LinearMath/Quaternion.h>
+#include <tf2_geometry_msgs/tf2_geometry_msgs.h>
+#include <cmath>
+#include "stereo_odometry.h"
+
+class StereoOdometryNode
+{
+    public:
+        struct Variances
+        {
+            double velocity;
+            double turn_rate;
+        };
+
+        StereoOdometryNode(ros::NodeHandle& n, const StereoOdometry::Parameters& p,
+                const Variances& v, const std::string& o_frame,
+                const std::string& b_frame) :
+            odometry{p},
+            parameters(p),
+            variances(v),
+            odometry_frame{o_frame},
+            base_frame{b_frame},
+            left_image{n, "left/image_rect", 2},
+            right_image{n, "right/image_rect", 2},
+            left_info{n, "left/camera_info", 2},
+            right_info{n, "right/camera_info", 2},
+            synchronizer{left_image, right_image, left_info, right_info, 5},
+            tf_buffer{},
+            tf_listener{tf_buffer}
+        {
+            publisher = n.advertise<nav_msgs::Odometry>("visual_odom", 10);
+            synchronizer.registerCallback(&StereoOdometryNode::process, this);
+        }
+        ~StereoOdometryNode() = default;
+        StereoOdometryNode(const StereoOdometryNode&) = delete;
+        StereoOdometryNode& operator=(const StereoOdometryNode&) = delete;
+        StereoOdometryNode(StereoOdometryNode&&) = delete;
+        StereoOdometryNode& operator=(StereoOdometryNode&&) = delete;
+
+    private:
+        StereoOdometry odometry;
+        const StereoOdometry::Parameters parameters;
+        const Variances variances;
+        const std::string& odometry_frame;
+        const std::string& base_frame;
+
+        message_filters::Subscriber<sensor_msgs::Image> left_image;
+        message_filters::Subscriber<sensor_msgs::Image> right_image;
+        message_filters::Subscriber<sensor_msgs::CameraInfo> left_info;
+        message_filters::Subscriber<sensor_msgs::CameraInfo> right_info;
+        message_filters::TimeSynchronizer<sensor_msgs::Image, sensor_msgs::Image,
+            sensor_msgs::CameraInfo, sensor_msgs::CameraInfo> synchronizer;
+        ros::Publisher publisher;
+        tf2_ros::Buffer tf_buffer;
+        tf2_ros::TransformListener tf_listener;
+
+        ros::Time last_stamp{};
+        tf2::Transform base_pose{tf2::Transform::getIdentity()};
+
+        //a longer gap isn't a velocity anymore
+        const double MAX_TIME_DELTA = 0.5;
+
+        void process(const sensor_msgs::ImageConstPtr& left,
+                const sensor_msgs::ImageConstPtr& right,
+                const sensor_msgs::CameraInfoConstPtr& left_camera,
+                const sensor_msgs::CameraInfoConstPtr& right_camera)
+        {
+            //the right projection's x translation is -fx * baseline
+            StereoOdometry::Calibration calibration{left_camera->P[0],
+                left_camera->P[5], left_camera->P[2], left_camera->P[6],
+                right_camera->P[0] != 0 ? -right_camera->P[3] / right_camera->P[0] : 0};
+            if (calibration.fx <= 0 || calibration.baseline <= 0)
+            {
+                ROS_WARN_THROTTLE(5, "Stereo Odometry: camera info has no stereo projection");
+                return;
+            }
+
+            tf2::Transform camera_to_base{};
+            try
+            {
+                auto stamped = tf_buffer.lookupTransform(base_frame,
+                        left->header.frame_id, ros::Time(0));
+                tf2::fromMsg(stamped.transform, camera_to_base);
+            }
+            catch (tf2::TransformException &ex)
+            {
+                ROS_WARN_THROTTLE(5, "Stereo Odometry: %s", ex.what());
+                return;
+            }
+
+            cv_bridge::CvImageConstPtr left_cv{}, right_cv{};
+            try
+            {
+                left_cv = cv_bridge::toCvShare(left, "mono8");
+                right_cv = cv_bridge::toCvShare(right, "mono8");
+            }
+            catch (cv_bridge::Exception &ex)
+            {
+                ROS_WARN_THROTTLE(5, "Stereo Odometry: %s", ex.what());
+                return;
+            }
+
+            cv::Matx44d motion{};
+            int inliers = 0;
+            bool tracked = odometry.process(left_cv->image, right_cv->image,
+                    calibration, motion, inliers);
+            ros::Time stamp = left->header.stamp;
+            double dt = (stamp - last_stamp).toSec();
+            bool fresh = !last_stamp.isZero() && dt > 0 && dt <= MAX_TIME_DELTA;
+            last_stamp = stamp;
+            if (!tracked)
+            {
+                ROS_WARN_THROTTLE(5, "Stereo Odometry: tracking lost, starting over");
+                return;
+            }
+            if (!fresh)
+                return;
+
+            //the same motion seen from the robot frame
+            tf2::Transform camera_motion{
+                tf2::Matrix3x3{motion(0, 0), motion(0, 1), motion(0, 2),
+                    motion(1, 0), motion(1, 1), motion(1, 2),
+                    motion(2, 0), motion(2, 1), motion(2, 2)},
+                tf2::Vector3{motion(0, 3), motion(1, 3), motion(2, 3)}};
+            tf2::Transform base_motion = camera_to_base * camera_motion *
+                camera_to_base.inverse();
+            base_pose = base_pose * base_motion;
+
+            double roll, pitch, yaw;
+            base_motion.getBasis().getRPY(roll, pitch, yaw);
+            double scale = static_cast<double>(parameters.min_inliers) / inliers;
+
+            nav_msgs::Odometry odom{};
+            odom.header.stamp = stamp;
+            odom.header.frame_id = odometry_frame;
+            odom.child_frame_id = base_frame;
+            tf2::toMsg(base_pose, odom.pose.pose);
+            odom.twist.twist.linear.x = base_motion.getOrigin().x() / dt;
+            odom.twist.twist.angular.z = yaw / dt;
+            odom.twist.covariance[0] = variances.velocity * scale;
+            odom.twist.covariance[35] = variances.turn_rate * scale;
+            publisher.publish(odom);
+        }
+};
+
+int main(int argc, char** argv)
+{
+    ros::init(argc, argv, "stereo_odometry");
+    ros::NodeHandle n{};
+
+    std::string odometry_frame, base_frame;
+    StereoOdometry::Parameters parameters{};
+    StereoOdometryNode::Variances variances{};
+    ros::param::param<std::string>("~odom_frame", odometry_frame, "odom");
+    ros::param::param<std::string>("~base_frame", base_frame, "base_footprint");
+    ros::param::param<int>("~features", parameters.features, 500);
+    ros::param::param<int>("~fast_threshold", parameters.fast_threshold, 20);
+    ros::param::param<int>("~window", parameters.window, 3);
+    ros::param::param<int>("~max_distance", parameters.max_distance, 64);
+    ros::param::param<double>("~ratio", parameters.ratio, 0.8);
+    ros::param::param<int>("~row_tolerance", parameters.row_tolerance, 2);
+    ros::param::param<double>("~min_disparity", parameters.min_disparity, 1.0);
+    ros::param::param<double>("~max_disparity", parameters.max_disparity, 100.0);
+    ros::param::param<double>("~reprojection_error", parameters.reprojection_error, 2.0);
+    ros::param::param<int>("~min_inliers", parameters.min_inliers, 20);
+    ros::param::param<int>("~keyframe_inliers", parameters.keyframe_inliers, 80);
+    ros::param::param<double>("~velocity_variance", variances.velocity, 0.01);
+    ros::param::param<double>("~turn_rate_variance", variances.turn_rate, 0.01);
+    if (parameters.min_disparity < 1)
+    {
+        ROS_WARN("Stereo Odometry: min_disparity has to be at least 1, using 1");
+        parameters.min_disparity = 1;
+    }
+    if (parameters.min_inliers < 6)
+    {
+        ROS_WARN("Stereo Odometry: min_inliers has to be at least 6, using 6");
+        parameters.min_inliers = 6;
+    }
+
+    StereoOdometryNode node{n, parameters, variances, odometry_frame, base_frame};
+    ros::spin();
+    return 0;
+}
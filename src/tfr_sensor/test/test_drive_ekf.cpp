@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include "drive_ekf.h"
+
+namespace
+{
+    DriveEkf::Noise noise()
+    {
+        return DriveEkf::Noise{1e-4, 1e-4, 0.5, 0.5, 1e-6};
+    }
+
+    DriveEkf startAt(double yaw)
+    {
+        DriveEkf filter{noise()};
+        DriveEkf::State state = DriveEkf::State::Zero();
+        state(DriveEkf::YAW) = yaw;
+        DriveEkf::Covariance covariance = DriveEkf::Covariance::Zero();
+        covariance.diagonal() << 1e-4, 1e-4, 1e-4, 1e-2, 1e-2, 1e-2;
+        filter.reset(state, covariance);
+        return filter;
+    }
+
+    //drives at a body frame speed for a while, measured at 100hz
+    void drive(DriveEkf &filter, double v, double omega, double seconds)
+    {
+        const double dt = 0.01;
+        for (int i = 0; i < static_cast<int>(seconds / dt + 0.5); i++)
+        {
+            filter.predict(dt);
+            filter.updateVelocity(v, omega, 1e-3, 1e-3);
+        }
+    }
+}
+
+TEST(DriveEkf, DrivesAlongHeading)
+{
+    const double headings[] = {0, M_PI / 2, M_PI, -M_PI / 2, 0.7};
+    for (double yaw : headings)
+    {
+        DriveEkf filter = startAt(yaw);
+        drive(filter, 0.5, 0, 2.0);
+        const auto &s = filter.state();
+        //the filter takes a few steps to pick up the speed from rest
+        ASSERT_NEAR(s(DriveEkf::X), std::cos(yaw), 0.05) << "yaw " << yaw;
+        ASSERT_NEAR(s(DriveEkf::Y), std::sin(yaw), 0.05) << "yaw " << yaw;
+        ASSERT_NEAR(DriveEkf::normalizeAngle(s(DriveEkf::YAW) - yaw), 0, 1e-3);
+        ASSERT_NEAR(s(DriveEkf::V), 0.5, 1e-2);
+    }
+}
+
+TEST(DriveEkf, Turns)
+{
+    DriveEkf filter = startAt(M_PI / 2);
+    drive(filter, 0, 0.5, 2.0);
+    const auto &s = filter.state();
+    ASSERT_NEAR(s(DriveEkf::X), 0, 1e-6);
+    ASSERT_NEAR(s(DriveEkf::Y), 0, 1e-6);
+    ASSERT_NEAR(DriveEkf::normalizeAngle(s(DriveEkf::YAW) - (M_PI / 2 + 1.0)), 0, 0.05);
+}
+
+TEST(DriveEkf, EstimatesGyroBias)
+{
+    DriveEkf filter = startAt(-M_PI / 2);
+    const double dt = 0.01, bias = 0.05;
+    for (int i = 0; i < 3000; i++)
+    {
+        filter.predict(dt);
+        filter.updateVelocity(0, 0, 1e-3, 1e-3);
+        filter.updateGyro(bias, 1e-4);
+    }
+    ASSERT_NEAR(filter.state()(DriveEkf::BIAS), bias, 5e-3);
+    ASSERT_NEAR(filter.state()(DriveEkf::OMEGA), 0, 5e-3);
+}
+
+TEST(DriveEkf, PoseUpdateWrapsYaw)
+{
+    DriveEkf filter = startAt(M_PI - 0.05);
+    Eigen::Matrix3d covariance = Eigen::Matrix3d::Identity() * 1e-4;
+    filter.updatePose(0, 0, -M_PI + 0.05, covariance);
+    //the short way around is through pi, not through 0
+    ASSERT_GT(std::fabs(filter.state()(DriveEkf::YAW)), M_PI - 0.06);
+}
@@ -11,14 +11,15 @@ namespace tfr_utilities
     namespace JointAngle
     {
         //NOTES must match up with constants in model
+        //(tfr_description/xacro/model_constants.xacro)
         static const float ARM_TURNTABLE_MAX = 6.28319;
         static const float ARM_TURNTABLE_MIN = 0.0;
-        static const float ARM_LOWER_MAX = 1.52;
-        static const float ARM_LOWER_MIN = 0.06;
-        static const float ARM_UPPER_MAX = 2.2;
-        static const float ARM_UPPER_MIN = 0.99;
-        static const float ARM_SCOOP_MAX = 1.1;
-        static const float ARM_SCOOP_MIN = -1.6;
+        static const float ARM_LOWER_MAX = 1.55;
+        static const float ARM_LOWER_MIN = 0.104;
+        static const float ARM_UPPER_MAX = 2.4;
+        static const float ARM_UPPER_MIN = 0.98;
+        static const float ARM_SCOOP_MAX = 1.62;
+        static const float ARM_SCOOP_MIN = -1.16614;
         static const float BIN_MAX = 0.74;
         static const float BIN_MIN = 0.01;
     }
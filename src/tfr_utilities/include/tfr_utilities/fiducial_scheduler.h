@@ -0,0 +1,94 @@
+/* Decides when the fiducial odometry should look for the board.
+ *
+ * Every look is two image fetches and two aruco detections, so they are
+ * spent where they help, going by the filtered odometry:
+ *   idle: standing still and sure of the pose, one look after stopping and
+ *   then none
+ *   normal: driving, looks at the normal rate
+ *   burst: turning fast or unsure of the pose, looks at the burst rate
+ *   lost: the board hasn't been seen for lost_timeout, no looks until the
+ *   robot has driven or turned enough for the view to have changed
+ *
+ * Without recent odometry it falls back to the normal rate.
+ * */
+#ifndef FIDUCIAL_SCHEDULER_H
+#define FIDUCIAL_SCHEDULER_H
+
+#include <ros/time.h>
+
+class FiducialScheduler
+{
+    public:
+        enum class Mode { IDLE, NORMAL, BURST, LOST };
+
+        struct Parameters
+        {
+            double normal_period;
+            double burst_period;
+            //slower than both of these is standing still
+            double still_speed;
+            double still_turn_rate;
+            //faster than this is a burst
+            double burst_turn_rate;
+            //position and yaw variances above these are a burst
+            double max_variance;
+            double max_yaw_variance;
+            double lost_timeout;
+            //how far to drive or turn before looking again once lost
+            double resume_distance;
+            double resume_angle;
+        };
+
+        //the latest filtered odometry
+        struct Motion
+        {
+            double x;
+            double y;
+            double yaw;
+            double velocity;
+            double turn_rate;
+            double position_variance;
+            double yaw_variance;
+        };
+
+        explicit FiducialScheduler(const Parameters &p);
+        ~FiducialScheduler() = default;
+        FiducialScheduler(const FiducialScheduler&) = delete;
+        FiducialScheduler& operator=(const FiducialScheduler&) = delete;
+        FiducialScheduler(FiducialScheduler&&) = delete;
+        FiducialScheduler& operator=(FiducialScheduler&&) = delete;
+
+        void updateMotion(const ros::Time &stamp, const Motion &motion);
+
+        //whether to look for the board now
+        bool due(const ros::Time &now);
+
+        //the outcome of a look made at now
+        void report(const ros::Time &now, bool sighted);
+
+        //look on the next call to due, whatever the mode
+        void wake();
+
+        Mode mode(const ros::Time &now) const;
+
+    private:
+        const Parameters parameters;
+
+        Motion last_motion;
+        ros::Time motion_stamp;
+        //when the robot last came to a stop, zero while moving
+        ros::Time still_since;
+
+        ros::Time last_query;
+        //the first look that missed since the last sighting, zero if none
+        ros::Time first_miss;
+        bool lost;
+        //driven and turned since getting lost
+        double travelled;
+        double turned;
+
+        //odometry older than this isn't used
+        const double MOTION_TIMEOUT = 1.0;
+};
+
+#endif
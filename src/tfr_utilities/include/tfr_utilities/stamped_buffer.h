@@ -0,0 +1,132 @@
+/* Fixed capacity ring buffer of time stamped values.
+ *
+ * Values have to be pushed in time order, anything not newer than the newest
+ * entry is dropped. Once full the oldest entry is overwritten, so memory use
+ * is fixed after construction.
+ *
+ * Lookups are by stamp: the newest entry at or before a time, the entry
+ * nearest a time, and the first entry newer than a time. Indexes passed to
+ * at() run from 0 (oldest) to size() - 1 (newest).
+ *
+ * Header only since it is a template.
+ * */
+#ifndef STAMPED_BUFFER_H
+#define STAMPED_BUFFER_H
+
+#include <ros/time.h>
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+template <typename T>
+class StampedBuffer
+{
+    public:
+        using Entry = std::pair<ros::Time, T>;
+
+        explicit StampedBuffer(std::size_t c) :
+            entries(c > 0 ? c : 1), head{0}, count{0}
+        {}
+        ~StampedBuffer() = default;
+        StampedBuffer(const StampedBuffer&) = delete;
+        StampedBuffer& operator=(const StampedBuffer&) = delete;
+        StampedBuffer(StampedBuffer&&) = delete;
+        StampedBuffer& operator=(StampedBuffer&&) = delete;
+
+        std::size_t size() const { return count; }
+        std::size_t capacity() const { return entries.size(); }
+        bool empty() const { return count == 0; }
+        void clear() { head = 0; count = 0; }
+
+        //0 is the oldest entry
+        Entry& at(std::size_t i) { return entries[(head + i) % entries.size()]; }
+        const Entry& at(std::size_t i) const { return entries[(head + i) % entries.size()]; }
+        const Entry& oldest() const { return at(0); }
+        const Entry& newest() const { return at(count - 1); }
+
+        /*
+         * Adds a value, false if it is not newer than the newest entry
+         * */
+        bool push(const ros::Time &stamp, const T &value)
+        {
+            if (count > 0 && stamp <= newest().first)
+                return false;
+            if (count == entries.size())
+            {
+                entries[head] = Entry{stamp, value};
+                head = (head + 1) % entries.size();
+            }
+            else
+            {
+                entries[(head + count) % entries.size()] = Entry{stamp, value};
+                ++count;
+            }
+            return true;
+        }
+
+        /*
+         * Index of the first entry newer than the stamp, size() if none are
+         * */
+        std::size_t upperBound(const ros::Time &stamp) const
+        {
+            std::size_t low = 0, high = count;
+            while (low < high)
+            {
+                std::size_t mid = (low + high) / 2;
+                if (at(mid).first <= stamp)
+                    low = mid + 1;
+                else
+                    high = mid;
+            }
+            return low;
+        }
+
+        /*
+         * The newest entry at or before the stamp, false if all are newer
+         * */
+        bool atOrBefore(const ros::Time &stamp, std::size_t &index) const
+        {
+            std::size_t upper = upperBound(stamp);
+            if (upper == 0)
+                return false;
+            index = upper - 1;
+            return true;
+        }
+
+        /*
+         * The entry closest in time to the stamp, false if empty
+         * */
+        bool nearest(const ros::Time &stamp, std::size_t &index) const
+        {
+            if (count == 0)
+                return false;
+            std::size_t upper = upperBound(stamp);
+            if (upper == 0)
+                index = 0;
+            else if (upper == count)
+                index = count - 1;
+            else
+                index = ((stamp - at(upper - 1).first) <= (at(upper).first - stamp)) ?
+                    upper - 1 : upper;
+            return true;
+        }
+
+        /*
+         * The oldest entry newer than the stamp, false if none are
+         * */
+        bool newerThan(const ros::Time &stamp, std::size_t &index) const
+        {
+            std::size_t upper = upperBound(stamp);
+            if (upper == count)
+                return false;
+            index = upper;
+            return true;
+        }
+
+    private:
+        std::vector<Entry> entries;
+        std::size_t head;
+        std::size_t count;
+};
+
+#endif
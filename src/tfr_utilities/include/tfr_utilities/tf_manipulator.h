@@ -23,10 +23,14 @@ class TfManipulator
         TfManipulator& operator=(TfManipulator&&)=delete;
         geometry_msgs::PoseStamped wrap_pose(const geometry_msgs::Pose &pose,
                 const std::string &pose_frame);
+        //looked up at the pose's stamp, a zero stamp means the latest
         bool transform_pose(const geometry_msgs::PoseStamped &from_pose, 
-                geometry_msgs::PoseStamped &out, const std::string &to_frame);
+                geometry_msgs::PoseStamped &out, const std::string &to_frame,
+                const ros::Duration &timeout = ros::Duration(0.1));
         bool get_transform(geometry_msgs::Transform &transform, 
-                const std::string &from_frame,const std::string &to_frame);
+                const std::string &from_frame,const std::string &to_frame,
+                const ros::Time &stamp = ros::Time(0),
+                const ros::Duration &timeout = ros::Duration(0));
     private:
         tf2_ros::Buffer buffer;
         tf2_ros::TransformListener listener;
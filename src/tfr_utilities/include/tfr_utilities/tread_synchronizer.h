@@ -0,0 +1,66 @@
+/* Utility class for pairing the left and right tread velocities.
+ *
+ * The left tread is read by arduino a and the right by arduino b, over two
+ * independent serial links at different rates, so the latest reading from
+ * each side can be tens of milliseconds apart. Combining them directly shows
+ * up as false yaw whenever the treads speed up, slow down or turn.
+ *
+ * This class buffers both streams and linearly interpolates them onto common
+ * timestamps (every sample time of either stream), only once both streams
+ * have reported past that time.
+ * */
+#ifndef TREAD_SYNCHRONIZER_H
+#define TREAD_SYNCHRONIZER_H
+
+#include <ros/time.h>
+#include <deque>
+#include <utility>
+#include <cstddef>
+
+class TreadSynchronizer
+{
+    public:
+        //a pair of tread velocities at the same instant
+        struct Sample
+        {
+            ros::Time stamp;
+            double left;
+            double right;
+        };
+
+        explicit TreadSynchronizer(std::size_t capacity = 32);
+        ~TreadSynchronizer() = default;
+        TreadSynchronizer(const TreadSynchronizer&) = delete;
+        TreadSynchronizer& operator=(const TreadSynchronizer&) = delete;
+        TreadSynchronizer(TreadSynchronizer&&) = delete;
+        TreadSynchronizer& operator=(TreadSynchronizer&&) = delete;
+
+        //adds a reading, readings older than the newest one are dropped
+        void addLeft(const ros::Time &stamp, const double &velocity);
+        void addRight(const ros::Time &stamp, const double &velocity);
+
+        //pops the next aligned sample, false if both sides don't cover it yet
+        bool next(Sample &out);
+
+        //the newest instant both sides cover, false until both have reported
+        bool latest(Sample &out) const;
+
+        //forgets everything, used when the streams can't be trusted to line up
+        void clear();
+
+    private:
+        using Stream = std::deque<std::pair<ros::Time, double>>;
+
+        void add(Stream &stream, const ros::Time &stamp, const double &velocity);
+        //the first stamp in the stream after the last emitted sample
+        bool nextStamp(const Stream &stream, ros::Time &stamp) const;
+        void prune(Stream &stream);
+        static double interpolate(const Stream &stream, const ros::Time &stamp);
+
+        const std::size_t capacity;
+        Stream left;
+        Stream right;
+        ros::Time last_emitted;
+};
+
+#endif
@@ -0,0 +1,92 @@
+#include <fiducial_scheduler.h>
+#include <cmath>
+
+FiducialScheduler::FiducialScheduler(const Parameters &p) :
+    parameters(p), last_motion{}, motion_stamp{}, still_since{},
+    last_query{}, first_miss{}, lost{false}, travelled{0}, turned{0}
+{}
+
+void FiducialScheduler::updateMotion(const ros::Time &stamp, const Motion &motion)
+{
+    if (lost && !motion_stamp.isZero())
+    {
+        travelled += std::hypot(motion.x - last_motion.x, motion.y - last_motion.y);
+        double difference = motion.yaw - last_motion.yaw;
+        turned += std::fabs(std::atan2(std::sin(difference), std::cos(difference)));
+        if (travelled >= parameters.resume_distance || turned >= parameters.resume_angle)
+        {
+            lost = false;
+            first_miss = ros::Time{};
+        }
+    }
+
+    bool still = std::fabs(motion.velocity) < parameters.still_speed &&
+        std::fabs(motion.turn_rate) < parameters.still_turn_rate;
+    if (!still)
+        still_since = ros::Time{};
+    else if (still_since.isZero())
+        still_since = stamp;
+
+    last_motion = motion;
+    motion_stamp = stamp;
+}
+
+FiducialScheduler::Mode FiducialScheduler::mode(const ros::Time &now) const
+{
+    if (lost)
+        return Mode::LOST;
+    if (motion_stamp.isZero() || (now - motion_stamp).toSec() > MOTION_TIMEOUT)
+        return Mode::NORMAL;
+    if (std::fabs(last_motion.turn_rate) > parameters.burst_turn_rate ||
+            last_motion.position_variance > parameters.max_variance ||
+            last_motion.yaw_variance > parameters.max_yaw_variance)
+        return Mode::BURST;
+    if (!still_since.isZero())
+        return Mode::IDLE;
+    return Mode::NORMAL;
+}
+
+bool FiducialScheduler::due(const ros::Time &now)
+{
+    if (last_query.isZero())
+        return true;
+    double elapsed = (now - last_query).toSec();
+    switch (mode(now))
+    {
+        case Mode::LOST:
+            return false;
+        case Mode::IDLE:
+            //one look once stopped, the pose won't change after that
+            return last_query < still_since;
+        case Mode::BURST:
+            return elapsed >= parameters.burst_period;
+        case Mode::NORMAL:
+        default:
+            return elapsed >= parameters.normal_period;
+    }
+}
+
+void FiducialScheduler::report(const ros::Time &now, bool sighted)
+{
+    last_query = now;
+    if (sighted)
+    {
+        first_miss = ros::Time{};
+        return;
+    }
+    if (first_miss.isZero())
+        first_miss = now;
+    if (!lost && (now - first_miss).toSec() >= parameters.lost_timeout)
+    {
+        lost = true;
+        travelled = 0;
+        turned = 0;
+    }
+}
+
+void FiducialScheduler::wake()
+{
+    lost = false;
+    first_miss = ros::Time{};
+    last_query = ros::Time{};
+}
@@ -30,21 +30,25 @@ geometry_msgs::PoseStamped TfManipulator::wrap_pose(const geometry_msgs::Pose
 }
 
 /**
- *  Transform pose from current to provided reference frame.
+ *  Transform pose from current to provided reference frame, as the frames
+ *  were at the pose's stamp. Waits up to the timeout for the transform to
+ *  arrive, so poses stamped just now still go through.
  *
  *  Relies on the transform buffer which needs time to fill, so if this is
  *  called before either reference frame has published transforms for a few
  *  seconds, it will fail, just repeatedly call it.
  * */
 bool TfManipulator::transform_pose(const geometry_msgs::PoseStamped &from_pose, 
-        geometry_msgs::PoseStamped &out, const std::string &to_frame)
+        geometry_msgs::PoseStamped &out, const std::string &to_frame,
+        const ros::Duration &timeout)
 {
     geometry_msgs::TransformStamped transform;
     try{
         transform = buffer.lookupTransform(
                 to_frame, 
                 from_pose.header.frame_id,
-                ros::Time(0));
+                from_pose.header.stamp,
+                timeout);
     }
     catch (tf2::TransformException &ex) {
         ROS_WARN("%s",ex.what());
@@ -54,18 +58,20 @@ bool TfManipulator::transform_pose(const geometry_msgs::PoseStamped &from_pose,
     return true;
 }
 /**
- *  easy interface for looking up a transform
+ *  easy interface for looking up a transform, at a time if one is given
  *
  * */
 bool TfManipulator::get_transform(geometry_msgs::Transform &output, 
-        const std::string &from_frame, const std::string &to_frame)
+        const std::string &from_frame, const std::string &to_frame,
+        const ros::Time &stamp, const ros::Duration &timeout)
 {
     geometry_msgs::TransformStamped transform;
     try{
         transform = buffer.lookupTransform(
                 from_frame,
                 to_frame, 
-                ros::Time(0));
+                stamp,
+                timeout);
          output = transform.transform;
     }
     catch (tf2::TransformException &ex) {
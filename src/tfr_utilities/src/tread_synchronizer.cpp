@@ -0,0 +1,122 @@
+#include <tread_synchronizer.h>
+#include <algorithm>
+
+TreadSynchronizer::TreadSynchronizer(std::size_t c) :
+    capacity{std::max<std::size_t>(c, 2)}, left{}, right{}, last_emitted{}
+{}
+
+void TreadSynchronizer::addLeft(const ros::Time &stamp, const double &velocity)
+{
+    add(left, stamp, velocity);
+}
+
+void TreadSynchronizer::addRight(const ros::Time &stamp, const double &velocity)
+{
+    add(right, stamp, velocity);
+}
+
+/*
+ * Emits samples in time order at the stamps of either stream, as long as
+ * both streams have a reading at or after that stamp to interpolate with.
+ * Nothing is emitted before both streams have started.
+ * */
+bool TreadSynchronizer::next(Sample &out)
+{
+    if (left.empty() || right.empty())
+        return false;
+
+    auto start = std::max(left.front().first, right.front().first);
+    auto frontier = std::min(left.back().first, right.back().first);
+
+    ros::Time stamp_l{}, stamp_r{};
+    bool has_l = nextStamp(left, stamp_l), has_r = nextStamp(right, stamp_r);
+    if (!has_l && !has_r)
+        return false;
+
+    ros::Time stamp;
+    if (has_l && has_r)
+        stamp = std::min(stamp_l, stamp_r);
+    else
+        stamp = has_l ? stamp_l : stamp_r;
+    //the first pair lines up at the later of the two first readings
+    stamp = std::max(stamp, start);
+    if (stamp > frontier || stamp <= last_emitted)
+        return false;
+
+    out.stamp = stamp;
+    out.left = interpolate(left, stamp);
+    out.right = interpolate(right, stamp);
+    last_emitted = stamp;
+    prune(left);
+    prune(right);
+    return true;
+}
+
+bool TreadSynchronizer::latest(Sample &out) const
+{
+    if (left.empty() || right.empty())
+        return false;
+    out.stamp = std::min(left.back().first, right.back().first);
+    out.left = interpolate(left, out.stamp);
+    out.right = interpolate(right, out.stamp);
+    return true;
+}
+
+void TreadSynchronizer::clear()
+{
+    left.clear();
+    right.clear();
+    last_emitted = ros::Time{};
+}
+
+void TreadSynchronizer::add(Stream &stream, const ros::Time &stamp,
+        const double &velocity)
+{
+    if (!stream.empty() && stamp <= stream.back().first)
+        return;
+    stream.emplace_back(stamp, velocity);
+    //the other side stalled, don't let this one grow without bound
+    if (stream.size() > capacity)
+        stream.pop_front();
+}
+
+bool TreadSynchronizer::nextStamp(const Stream &stream, ros::Time &stamp) const
+{
+    for (const auto &reading : stream)
+    {
+        if (reading.first > last_emitted)
+        {
+            stamp = reading.first;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Keeps the newest reading at or before the last emitted sample, it is the
+ * lower bracket for the next interpolation.
+ * */
+void TreadSynchronizer::prune(Stream &stream)
+{
+    while (stream.size() >= 2 && stream[1].first <= last_emitted)
+        stream.pop_front();
+}
+
+/*
+ * Linear interpolation between the readings on either side of the stamp,
+ * holds the first reading for stamps before it.
+ * */
+double TreadSynchronizer::interpolate(const Stream &stream, const ros::Time &stamp)
+{
+    auto upper = std::lower_bound(stream.begin(), stream.end(), stamp,
+            [](const std::pair<ros::Time, double> &reading, const ros::Time &t)
+            { return reading.first < t; });
+    if (upper == stream.end())
+        return stream.back().second;
+    if (upper == stream.begin() || upper->first == stamp)
+        return upper->second;
+    auto lower = upper - 1;
+    double ratio = (stamp - lower->first).toSec() / (upper->first - lower->first).toSec();
+    return lower->second + ratio * (upper->second - lower->second);
+}
@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+#include "fiducial_scheduler.h"
+
+namespace
+{
+    FiducialScheduler::Parameters parameters()
+    {
+        FiducialScheduler::Parameters p{};
+        p.normal_period = 0.2;
+        p.burst_period = 0.05;
+        p.still_speed = 0.02;
+        p.still_turn_rate = 0.02;
+        p.burst_turn_rate = 0.2;
+        p.max_variance = 0.05;
+        p.max_yaw_variance = 0.02;
+        p.lost_timeout = 2.0;
+        p.resume_distance = 0.5;
+        p.resume_angle = 0.5;
+        return p;
+    }
+
+    FiducialScheduler::Motion motion(double velocity, double turn_rate,
+            double variance = 0.001)
+    {
+        return FiducialScheduler::Motion{0, 0, 0, velocity, turn_rate, variance, variance};
+    }
+}
+
+TEST(FiducialScheduler, LooksOnceWhenStill)
+{
+    FiducialScheduler scheduler{parameters()};
+    scheduler.updateMotion(ros::Time(10.0), motion(0, 0));
+    ASSERT_EQ(scheduler.mode(ros::Time(10.0)), FiducialScheduler::Mode::IDLE);
+    ASSERT_TRUE(scheduler.due(ros::Time(10.0)));
+    scheduler.report(ros::Time(10.0), true);
+    scheduler.updateMotion(ros::Time(15.0), motion(0, 0));
+    ASSERT_FALSE(scheduler.due(ros::Time(15.0)));
+}
+
+TEST(FiducialScheduler, RatesFollowMotion)
+{
+    FiducialScheduler scheduler{parameters()};
+    scheduler.updateMotion(ros::Time(10.0), motion(0.3, 0));
+    scheduler.report(ros::Time(10.0), true);
+    ASSERT_EQ(scheduler.mode(ros::Time(10.1)), FiducialScheduler::Mode::NORMAL);
+    ASSERT_FALSE(scheduler.due(ros::Time(10.1)));
+    ASSERT_TRUE(scheduler.due(ros::Time(10.25)));
+
+    scheduler.updateMotion(ros::Time(10.1), motion(0, 0.5));
+    ASSERT_EQ(scheduler.mode(ros::Time(10.1)), FiducialScheduler::Mode::BURST);
+    ASSERT_TRUE(scheduler.due(ros::Time(10.1)));
+
+    //unsure of the pose while parked
+    scheduler.updateMotion(ros::Time(10.1), motion(0, 0, 0.1));
+    ASSERT_EQ(scheduler.mode(ros::Time(10.1)), FiducialScheduler::Mode::BURST);
+
+    //stale odometry falls back to the normal rate
+    ASSERT_EQ(scheduler.mode(ros::Time(12.0)), FiducialScheduler::Mode::NORMAL);
+}
+
+TEST(FiducialScheduler, GivesUpUntilMoved)
+{
+    FiducialScheduler scheduler{parameters()};
+    scheduler.updateMotion(ros::Time(10.0), motion(0.3, 0));
+    scheduler.report(ros::Time(10.0), false);
+    scheduler.report(ros::Time(12.0), false);
+    ASSERT_EQ(scheduler.mode(ros::Time(12.0)), FiducialScheduler::Mode::LOST);
+    ASSERT_FALSE(scheduler.due(ros::Time(20.0)));
+
+    //turning in place is enough to look again
+    FiducialScheduler::Motion turned = motion(0, 0.3);
+    turned.yaw = 0.6;
+    scheduler.updateMotion(ros::Time(12.5), turned);
+    ASSERT_NE(scheduler.mode(ros::Time(12.5)), FiducialScheduler::Mode::LOST);
+    ASSERT_TRUE(scheduler.due(ros::Time(12.5)));
+
+    scheduler.report(ros::Time(12.5), false);
+    scheduler.report(ros::Time(15.0), false);
+    ASSERT_EQ(scheduler.mode(ros::Time(15.0)), FiducialScheduler::Mode::LOST);
+    scheduler.wake();
+    ASSERT_TRUE(scheduler.due(ros::Time(15.0)));
+}
@@ -0,0 +1,37 @@
+#include <gtest/gtest.h>
+#include "stamped_buffer.h"
+
+TEST(StampedBuffer, Wraps)
+{
+    StampedBuffer<int> buffer{3};
+    for (int i = 1; i <= 5; i++)
+        ASSERT_TRUE(buffer.push(ros::Time(i), i));
+    ASSERT_EQ(buffer.size(), 3u);
+    ASSERT_EQ(buffer.oldest().second, 3);
+    ASSERT_EQ(buffer.newest().second, 5);
+    //out of order values are dropped
+    ASSERT_FALSE(buffer.push(ros::Time(4.5), 0));
+    ASSERT_EQ(buffer.newest().second, 5);
+}
+
+TEST(StampedBuffer, Lookup)
+{
+    StampedBuffer<int> buffer{4};
+    buffer.push(ros::Time(1.0), 1);
+    buffer.push(ros::Time(2.0), 2);
+    buffer.push(ros::Time(3.0), 3);
+
+    std::size_t index;
+    ASSERT_FALSE(buffer.atOrBefore(ros::Time(0.5), index));
+    ASSERT_TRUE(buffer.atOrBefore(ros::Time(2.5), index));
+    ASSERT_EQ(buffer.at(index).second, 2);
+
+    ASSERT_TRUE(buffer.nearest(ros::Time(2.6), index));
+    ASSERT_EQ(buffer.at(index).second, 3);
+    ASSERT_TRUE(buffer.nearest(ros::Time(9.0), index));
+    ASSERT_EQ(buffer.at(index).second, 3);
+
+    ASSERT_TRUE(buffer.newerThan(ros::Time(2.0), index));
+    ASSERT_EQ(buffer.at(index).second, 3);
+    ASSERT_FALSE(buffer.newerThan(ros::Time(3.0), index));
+}
@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+#include "tread_synchronizer.h"
+
+TEST(TreadSynchronizer, WaitsForBothSides)
+{
+    TreadSynchronizer synchronizer{};
+    TreadSynchronizer::Sample sample{};
+    synchronizer.addLeft(ros::Time(1.0), 1.0);
+    synchronizer.addLeft(ros::Time(1.1), 2.0);
+    ASSERT_FALSE(synchronizer.next(sample));
+    ASSERT_FALSE(synchronizer.latest(sample));
+}
+
+TEST(TreadSynchronizer, Interpolates)
+{
+    TreadSynchronizer synchronizer{};
+    TreadSynchronizer::Sample sample{};
+    synchronizer.addLeft(ros::Time(1.0), 1.0);
+    synchronizer.addLeft(ros::Time(1.1), 2.0);
+    synchronizer.addRight(ros::Time(1.05), 5.0);
+    synchronizer.addRight(ros::Time(1.15), 6.0);
+
+    ASSERT_TRUE(synchronizer.next(sample));
+    ASSERT_EQ(sample.stamp, ros::Time(1.05));
+    ASSERT_NEAR(sample.left, 1.5, 1e-6);
+    ASSERT_NEAR(sample.right, 5.0, 1e-6);
+
+    ASSERT_TRUE(synchronizer.next(sample));
+    ASSERT_EQ(sample.stamp, ros::Time(1.1));
+    ASSERT_NEAR(sample.left, 2.0, 1e-6);
+    ASSERT_NEAR(sample.right, 5.5, 1e-6);
+
+    //the left side hasn't reported past 1.1 yet
+    ASSERT_FALSE(synchronizer.next(sample));
+}
+
+TEST(TreadSynchronizer, DropsStaleReadings)
+{
+    TreadSynchronizer synchronizer{};
+    TreadSynchronizer::Sample sample{};
+    synchronizer.addLeft(ros::Time(1.0), 1.0);
+    synchronizer.addLeft(ros::Time(2.0), 3.0);
+    synchronizer.addLeft(ros::Time(1.5), 100.0);
+    synchronizer.addRight(ros::Time(2.0), 4.0);
+
+    ASSERT_TRUE(synchronizer.latest(sample));
+    ASSERT_EQ(sample.stamp, ros::Time(2.0));
+    ASSERT_NEAR(sample.left, 3.0, 1e-6);
+    ASSERT_NEAR(sample.right, 4.0, 1e-6);
+}